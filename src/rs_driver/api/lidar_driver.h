@@ -107,6 +107,18 @@ public:
     driver_ptr_->regRecvCallback(callback);
   }
 
+  /**
+   * @brief Register the columnar point cloud callback function to driver. If any such callback is registered, the
+   * decoders write x, y, z, intensity, ring and timestamp directly into the columns of a PointCloudSoA. Callbacks of
+   * PointCloudMsg, if any, then get a copy converted from the columns
+   * @note Register it before calling start()
+   * @param callback The callback function
+   */
+  inline void regRecvCallback(const std::function<void(const PointCloudSoAMsg&)>& callback)
+  {
+    driver_ptr_->regRecvCallback(callback);
+  }
+
   /**
    * @brief Register the lidar scan message callback function to driver.When lidar scan message is ready, this function
    * will be called
@@ -157,7 +169,30 @@ public:
   }
 
   /**
-   * @brief Decode lidar scan messages to point cloud
+   * @brief Get the counters of the received and the dropped packets, e.g. to tell packets lost in the kernel from
+   * packets lost because the decoder fell behind
+   * @param stats The variable to store the counters
+   * @return if the driver is initialized, return true; else return false
+   */
+  inline bool getStatistics(RSDriverStatistics& stats)
+  {
+    return driver_ptr_->getStatistics(stats);
+  }
+
+  /**
+   * @brief Update the transform parameter while the driver is running. The new transform is applied from the next
+   * decoded packet
+   * @note Points are only transformed when the driver is built with ENABLE_TRANSFORM
+   * @param param The new transform parameter
+   * @return if the decoder is initialized, return true; else return false
+   */
+  inline bool setTransformParam(const RSTransformParam& param)
+  {
+    return driver_ptr_->setTransformParam(param);
+  }
+
+  /**
+   * @brief Decode lidar scan messages to point cloud. Large scans are decoded on several threads
    * @note This function will only work after decodeDifopPkt is called unless wait_for_difop is set to false
    * @param pkt_scan_msg The lidar scan message
    * @param point_cloud_msg The output point cloud message
@@ -168,6 +203,53 @@ public:
     return driver_ptr_->decodeMsopScan(pkt_scan_msg, point_msg);
   }
 
+  /**
+   * @brief Decode lidar scan messages to a columnar point cloud
+   * @note This function will only work after decodeDifopPkt is called unless wait_for_difop is set to false
+   * @param pkt_scan_msg The lidar scan message
+   * @param point_msg The output point cloud message
+   * @return if decode successfully, return true; else return false
+   */
+  inline bool decodeMsopScan(const ScanMsg& pkt_scan_msg, PointCloudSoAMsg& point_msg)
+  {
+    return driver_ptr_->decodeMsopScan(pkt_scan_msg, point_msg);
+  }
+
+  /**
+   * @brief Prepare one lidar msop packet for decodePacket(): update the frame splitting state, temperature and camera
+   * trigger, and fill ctx with everything the points of the packet depend on besides the packet itself
+   * @note Must be called from one thread, in packet order. Call initDecoderOnly() first
+   * @param pkt_msg The lidar msop packet
+   * @param ctx The context of the packet, ctx.point_num is the number of points it decodes to
+   * @return FRAME_SPLIT if the packet is the last one of a frame, DECODE_OK, or a negative value on error
+   */
+  inline RSDecoderResult prepareMsopPkt(const PacketMsg& pkt_msg, PacketContext& ctx)
+  {
+    return driver_ptr_->prepareMsopPkt(pkt_msg, ctx);
+  }
+
+  /**
+   * @brief Decode the points of a lidar msop packet prepared by prepareMsopPkt() into ctx.point_num points of cloud
+   * from cloud.size() on. Thread safe: packets of any frame may be decoded on several threads at once, while another
+   * thread goes on preparing packets. Only decodeDifopPkt() must not be called meanwhile
+   * @param pkt_msg The lidar msop packet
+   * @param ctx The context filled by prepareMsopPkt()
+   * @param cloud The part of a point cloud, already sized for the whole frame, to write to
+   */
+  inline void decodePacket(const PacketMsg& pkt_msg, const PacketContext& ctx,
+                           CloudSlice<typename PointCloudMsg<PointT>::PointCloud>& cloud) const
+  {
+    driver_ptr_->decodePacket(pkt_msg, ctx, cloud);
+  }
+
+  /**
+   * @brief Decode the points of a lidar msop packet prepared by prepareMsopPkt() into a columnar point cloud
+   */
+  inline void decodePacket(const PacketMsg& pkt_msg, const PacketContext& ctx, CloudSlice<PointCloudSoA>& cloud) const
+  {
+    driver_ptr_->decodePacket(pkt_msg, ctx, cloud);
+  }
+
   /**
    * @brief Decode lidar difop messages
    * @param pkt_msg The lidar difop packet
@@ -177,6 +259,43 @@ public:
     driver_ptr_->decodeDifopPkt(pkt_msg);
   }
 
+  /**
+   * @brief Move the pcap replay to the start of a frame. The first seek indexes the pcap file, and saves the index
+   * next to it (pcap_path + ".rsidx"), so that later runs seek at once
+   * @note Only works when reading a pcap file, on Linux. Must not be called from the callbacks of the driver
+   * @param frame The frame number, counting from 0
+   * @return if the frame exists, return true; else return false
+   */
+  inline bool seekFrame(const uint32_t& frame)
+  {
+    return driver_ptr_->seekFrame(frame);
+  }
+
+  /**
+   * @brief Move the pcap replay to the start of the frame a LiDAR time falls into. See seekFrame(). If the LiDAR
+   * time is not monotonic in the file, the frames are searched in file order, see PcapIndex::findFrame()
+   * @param timestamp The LiDAR time, unit: s
+   * @return if the pcap file is indexed successfully, return true; else return false
+   */
+  inline bool seekTime(const double& timestamp)
+  {
+    return driver_ptr_->seekTime(timestamp);
+  }
+
+#ifdef __linux__
+  /**
+   * @brief Share the input threads and the decoding threads of a reactor with other drivers, instead of creating
+   * threads of its own. The reactor must outlive the driver
+   * @note Call it before init()
+   * @param reactor The reactor, e.g. std::make_shared<InputReactor>(1)
+   * @return If the driver is not initialized yet, return true; else return false
+   */
+  inline bool setInputReactor(const InputReactor::Ptr& reactor)
+  {
+    return driver_ptr_->setInputReactor(reactor);
+  }
+#endif
+
 private:
   std::shared_ptr<LidarDriverImpl<PointT>> driver_ptr_;  ///< The driver pointer
 };
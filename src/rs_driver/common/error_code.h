@@ -66,7 +66,10 @@ enum ErrCode
   ERRCODE_DIFOPPORTBUZY = 0x50,    ///< Input difop port is already used
   ERRCODE_WRONGPKTHEADER = 0x51,   ///< Packet header is wrong
   ERRCODE_PKTNULL = 0x52,          ///< Input packet is null
-  ERRCODE_PKTBUFOVERFLOW = 0x53    ///< Packet buffer is over flow
+  ERRCODE_PKTBUFOVERFLOW = 0x53,   ///< Packet buffer is over flow
+  ERRCODE_RECORDOVERFLOW = 0x54,   ///< Recorder buffers are full, packets are not recorded
+  ERRCODE_RECORDFAILED = 0x55,     ///< Record file can not be opened or written, recording stops
+  ERRCODE_PCAPCORRUPT = 0x56       ///< Compressed pcap file is corrupt or truncated, its replay ended early
 };
 
 struct Error
@@ -122,6 +125,12 @@ struct Error
         return "ERRCODE_PKTNULL";
       case ERRCODE_PKTBUFOVERFLOW:
         return "ERRCODE_PKTBUFOVERFLOW";
+      case ERRCODE_RECORDOVERFLOW:
+        return "ERRCODE_RECORDOVERFLOW";
+      case ERRCODE_RECORDFAILED:
+        return "ERRCODE_RECORDFAILED";
+      case ERRCODE_PCAPCORRUPT:
+        return "ERRCODE_PCAPCORRUPT";
       default:
         return "ERRCODE_SUCCESS";
     }
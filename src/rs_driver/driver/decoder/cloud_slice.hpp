@@ -0,0 +1,103 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+#include <rs_driver/common/common_header.h>
+namespace robosense
+{
+namespace lidar
+{
+/**
+ * @brief Decoder output which writes into a part of a cloud that is already sized for the whole frame, so that the
+ * packets of a frame can be decoded into their own parts at the same time. The decoders use it like a growing cloud:
+ * size() is the index in the frame of the next point and resize() claims the next block of points. With a stride the
+ * points are placed row-major like RowMajorCloud does, otherwise in decoding order.
+ * @note T_Cloud is std::vector<T_Point> or PointCloudSoA
+ */
+template <typename T_Cloud>
+class CloudSlice
+{
+public:
+  /**
+   * @param begin Index in the frame of the first point of the slice, the start of a column if stride is not 0
+   * @param height Number of rows of the frame
+   * @param stride Number of columns of the frame if it is row-major, or 0
+   */
+  inline CloudSlice(T_Cloud& cloud, const size_t& begin, const size_t& height, const size_t& stride)
+    : cloud_(&cloud), height_(height), stride_(stride), point_num_(begin), block_offset_(begin), block_col_(0)
+  {
+  }
+
+  inline size_t size() const  ///< Index in the frame of the next point
+  {
+    return point_num_;
+  }
+
+  inline void resize(const size_t& point_num)  ///< The decoders resize the cloud before writing a block of points
+  {
+    block_offset_ = point_num_;
+    block_col_ = point_num_ / height_;
+    point_num_ = point_num;
+  }
+
+  inline T_Cloud& cloud()
+  {
+    return *cloud_;
+  }
+
+  inline size_t index(const size_t& idx) const  ///< Position in the cloud of the idx-th point of the frame
+  {
+    if (stride_ == 0)
+    {
+      return idx;
+    }
+    size_t row = idx - block_offset_;
+    size_t col = block_col_;
+    while (row >= height_)
+    {
+      row -= height_;
+      col++;
+    }
+    return row * stride_ + col;
+  }
+
+private:
+  T_Cloud* cloud_;
+  size_t height_;
+  size_t stride_;
+  size_t point_num_;
+  size_t block_offset_;  ///< Index of the block being written, which always starts a new column
+  size_t block_col_;
+};
+
+}  // namespace lidar
+}  // namespace robosense
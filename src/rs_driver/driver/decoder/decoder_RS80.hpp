@@ -84,8 +84,21 @@ class DecoderRS80 : public DecoderBase<T_Point>
 public:
   explicit DecoderRS80(const RSDecoderParam& param, const LidarConstantParameter& lidar_const_param);
   RSDecoderResult decodeDifopPkt(const uint8_t* pkt);
-  RSDecoderResult decodeMsopPkt(const uint8_t* pkt, std::vector<T_Point>& vec, int& height, int& azimuth);
+  RSDecoderResult preparePacket(const uint8_t* pkt, PacketContext& ctx);
+  void decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx, std::vector<T_Point>& vec) const;
+  void decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx, PointCloudSoA& cloud) const;
+  void decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx, RowMajorCloud<std::vector<T_Point>>& cloud) const;
+  void decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx, RowMajorCloud<PointCloudSoA>& cloud) const;
+  void decodePacket(const uint8_t* pkt, const PacketContext& ctx, CloudSlice<std::vector<T_Point>>& cloud) const;
+  void decodePacket(const uint8_t* pkt, const PacketContext& ctx, CloudSlice<PointCloudSoA>& cloud) const;
   double getLidarTime(const uint8_t* pkt);
+
+protected:
+  float getChannelAzimuthFactor(const size_t& channel);
+
+private:
+  template <typename T_Cloud>
+  void decodeMsopPktImpl(const uint8_t* pkt, const PacketContext& ctx, T_Cloud& cloud) const;
 };
 
 template <typename T_Point>
@@ -103,6 +116,7 @@ inline DecoderRS80<T_Point>::DecoderRS80(const RSDecoderParam& param, const Lida
   {
     this->param_.min_distance = 1.0f;
   }
+  this->buildChannelTable();
 }
 
 template <typename T_Point>
@@ -112,27 +126,90 @@ inline double DecoderRS80<T_Point>::getLidarTime(const uint8_t* pkt)
 }
 
 template <typename T_Point>
-inline RSDecoderResult DecoderRS80<T_Point>::decodeMsopPkt(const uint8_t* pkt, std::vector<T_Point>& vec, int& height,
-                                                           int& azimuth)
+inline float DecoderRS80<T_Point>::getChannelAzimuthFactor(const size_t& channel)
+{
+  int dsr_temp = (channel / 4) % 16;
+  return static_cast<float>(dsr_temp) * this->lidar_const_param_.DSR_TOFFSET *
+         this->lidar_const_param_.FIRING_FREQUENCY;
+}
+
+template <typename T_Point>
+inline void DecoderRS80<T_Point>::decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx,
+                                                std::vector<T_Point>& vec) const
 {
-  height = this->lidar_const_param_.LASER_NUM;
+  decodeMsopPktImpl(pkt, ctx, vec);
+}
+
+template <typename T_Point>
+inline void DecoderRS80<T_Point>::decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx,
+                                                PointCloudSoA& cloud) const
+{
+  decodeMsopPktImpl(pkt, ctx, cloud);
+}
+
+template <typename T_Point>
+inline void DecoderRS80<T_Point>::decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx,
+                                                RowMajorCloud<std::vector<T_Point>>& cloud) const
+{
+  decodeMsopPktImpl(pkt, ctx, cloud);
+}
+
+template <typename T_Point>
+inline void DecoderRS80<T_Point>::decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx,
+                                                RowMajorCloud<PointCloudSoA>& cloud) const
+{
+  decodeMsopPktImpl(pkt, ctx, cloud);
+}
+
+template <typename T_Point>
+inline void DecoderRS80<T_Point>::decodePacket(const uint8_t* pkt, const PacketContext& ctx,
+                                               CloudSlice<std::vector<T_Point>>& cloud) const
+{
+  decodeMsopPktImpl(pkt, ctx, cloud);
+}
+
+template <typename T_Point>
+inline void DecoderRS80<T_Point>::decodePacket(const uint8_t* pkt, const PacketContext& ctx,
+                                               CloudSlice<PointCloudSoA>& cloud) const
+{
+  decodeMsopPktImpl(pkt, ctx, cloud);
+}
+
+template <typename T_Point>
+inline RSDecoderResult DecoderRS80<T_Point>::preparePacket(const uint8_t* pkt, PacketContext& ctx)
+{
+  ctx.height = this->lidar_const_param_.LASER_NUM;
   const RS80MsopPkt* mpkt_ptr = reinterpret_cast<const RS80MsopPkt*>(pkt);
   if (mpkt_ptr->header.id != this->lidar_const_param_.MSOP_ID)
   {
     return RSDecoderResult::WRONG_PKT_HEADER;
   }
   this->protocol_ver_ = RS_SWAP_SHORT(mpkt_ptr->header.protocol_version);
-  azimuth = RS_SWAP_SHORT(mpkt_ptr->blocks[0].azimuth);
+  ctx.azimuth = RS_SWAP_SHORT(mpkt_ptr->blocks[0].azimuth);
   this->current_temperature_ = this->computeTemperature(mpkt_ptr->header.temp_low, mpkt_ptr->header.temp_high);
-  double block_timestamp = this->get_point_time_func_(pkt);
-  this->check_camera_trigger_func_(azimuth, pkt);
+  ctx.timestamp = this->get_point_time_func_(pkt);
+  this->check_camera_trigger_func_(ctx.azimuth, pkt);
+  size_t blk_num = 0;
+  while (blk_num < this->lidar_const_param_.BLOCKS_PER_PKT &&
+         mpkt_ptr->blocks[blk_num].id == this->lidar_const_param_.BLOCK_ID)
+  {
+    blk_num++;
+  }
+  ctx.point_num = blk_num * this->lidar_const_param_.CHANNELS_PER_BLOCK;
+  return RSDecoderResult::DECODE_OK;
+}
+
+template <typename T_Point>
+template <typename T_Cloud>
+inline void DecoderRS80<T_Point>::decodeMsopPktImpl(const uint8_t* pkt, const PacketContext& ctx, T_Cloud& cloud) const
+{
+  const RS80MsopPkt* mpkt_ptr = reinterpret_cast<const RS80MsopPkt*>(pkt);
+  double block_timestamp = ctx.timestamp;
   float azi_diff = 0;
-  for (size_t blk_idx = 0; blk_idx < this->lidar_const_param_.BLOCKS_PER_PKT; blk_idx++)
+  BlockPoints block;
+  const size_t blk_num = ctx.point_num / this->lidar_const_param_.CHANNELS_PER_BLOCK;
+  for (size_t blk_idx = 0; blk_idx < blk_num; blk_idx++)
   {
-    if (mpkt_ptr->blocks[blk_idx].id != this->lidar_const_param_.BLOCK_ID)
-    {
-      break;
-    }
     int cur_azi = RS_SWAP_SHORT(mpkt_ptr->blocks[blk_idx].azimuth);
     if (this->echo_mode_ == ECHO_DUAL)
     {
@@ -168,33 +245,18 @@ inline RSDecoderResult DecoderRS80<T_Point>::decodeMsopPkt(const uint8_t* pkt, s
       }
     }
     azi_diff = (azi_diff > 100) ? this->azi_diff_between_block_theoretical_ : azi_diff;
+    this->decodeBlock(ctx, mpkt_ptr->blocks[blk_idx].channels, cur_azi, azi_diff, RS_DIS_RESOLUTION, block);
+    const size_t point_offset = cloud.size();
+    cloud.resize(point_offset + this->lidar_const_param_.CHANNELS_PER_BLOCK);
     for (size_t channel_idx = 0; channel_idx < this->lidar_const_param_.CHANNELS_PER_BLOCK; channel_idx++)
     {
-      int dsr_temp = (channel_idx / 4) % 16;
-      float azi_channel_ori = RS_SWAP_SHORT(mpkt_ptr->blocks[blk_idx].azimuth) +
-                              (azi_diff * static_cast<float>(dsr_temp) * this->lidar_const_param_.DSR_TOFFSET *
-                               this->lidar_const_param_.FIRING_FREQUENCY);
-      int azi_channel_final = this->azimuthCalibration(azi_channel_ori, channel_idx);
-      float distance = RS_SWAP_SHORT(mpkt_ptr->blocks[blk_idx].channels[channel_idx].distance) * RS_DIS_RESOLUTION;
-      int angle_horiz = static_cast<int>(azi_channel_ori + RS_ONE_ROUND) % RS_ONE_ROUND;
-      int angle_vert = ((this->vert_angle_list_[channel_idx]) + RS_ONE_ROUND) % RS_ONE_ROUND;
-
-      T_Point point;
-      if ((distance <= this->param_.max_distance && distance >= this->param_.min_distance) &&
-          ((this->angle_flag_ && azi_channel_final >= this->start_angle_ && azi_channel_final <= this->end_angle_) ||
-           (!this->angle_flag_ &&
-            ((azi_channel_final >= this->start_angle_) || (azi_channel_final <= this->end_angle_)))))
+      auto&& point = getPointRef(cloud, point_offset + channel_idx);
+      if (block.valid[channel_idx])
       {
-        float x = distance * this->checkCosTable(angle_vert) * this->checkCosTable(azi_channel_final) +
-                  this->lidar_const_param_.RX * this->checkCosTable(angle_horiz);
-        float y = -distance * this->checkCosTable(angle_vert) * this->checkSinTable(azi_channel_final) -
-                  this->lidar_const_param_.RX * this->checkSinTable(angle_horiz);
-        float z = distance * this->checkSinTable(angle_vert) + this->lidar_const_param_.RZ;
         uint8_t intensity = mpkt_ptr->blocks[blk_idx].channels[channel_idx].intensity;
-        this->transformPoint(x, y, z);
-        setX(point, x);
-        setY(point, y);
-        setZ(point, z);
+        setX(point, block.x[channel_idx]);
+        setY(point, block.y[channel_idx]);
+        setZ(point, block.z[channel_idx]);
         setIntensity(point, intensity);
       }
       else
@@ -206,10 +268,8 @@ inline RSDecoderResult DecoderRS80<T_Point>::decodeMsopPkt(const uint8_t* pkt, s
       }
       setRing(point, this->beam_ring_table_[channel_idx]);
       setTimestamp(point, block_timestamp);
-      vec.emplace_back(std::move(point));
     }
   }
-  return RSDecoderResult::DECODE_OK;
 }
 
 template <typename T_Point>
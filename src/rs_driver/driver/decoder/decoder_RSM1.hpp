@@ -140,9 +140,21 @@ class DecoderRSM1 : public DecoderBase<T_Point>
 public:
   DecoderRSM1(const RSDecoderParam& param, const LidarConstantParameter& lidar_const_param);
   RSDecoderResult decodeDifopPkt(const uint8_t* pkt);
-  RSDecoderResult decodeMsopPkt(const uint8_t* pkt, std::vector<T_Point>& vec, int& height, int& azimuth);
+  RSDecoderResult preparePacket(const uint8_t* pkt, PacketContext& ctx);
+  void decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx, std::vector<T_Point>& vec) const;
+  void decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx, PointCloudSoA& cloud) const;
+  void decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx, RowMajorCloud<std::vector<T_Point>>& cloud) const;
+  void decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx, RowMajorCloud<PointCloudSoA>& cloud) const;
+  void decodePacket(const uint8_t* pkt, const PacketContext& ctx, CloudSlice<std::vector<T_Point>>& cloud) const;
+  void decodePacket(const uint8_t* pkt, const PacketContext& ctx, CloudSlice<PointCloudSoA>& cloud) const;
   double getLidarTime(const uint8_t* pkt);
-  RSDecoderResult processMsopPkt(const uint8_t* pkt, std::vector<T_Point>& pointcloud_vec, int& height);
+  RSDecoderResult prepareMsopPkt(const uint8_t* pkt, PacketContext& ctx);
+  void restartFrame();
+  size_t getMaxPointsPerFrame();
+
+private:
+  template <typename T_Cloud>
+  void decodeMsopPktImpl(const uint8_t* pkt, const PacketContext& ctx, T_Cloud& cloud) const;
 
 private:
   uint32_t last_pkt_cnt_;
@@ -172,11 +184,68 @@ inline double DecoderRSM1<T_Point>::getLidarTime(const uint8_t* pkt)
 }
 
 template <typename T_Point>
-inline RSDecoderResult DecoderRSM1<T_Point>::processMsopPkt(const uint8_t* pkt, std::vector<T_Point>& pointcloud_vec,
-                                                            int& height)
+inline size_t DecoderRSM1<T_Point>::getMaxPointsPerFrame()
+{
+  size_t pkt_num = (this->param_.split_frame_mode == SplitFrameMode::SPLIT_BY_CUSTOM_PKTS) ?
+                       this->param_.num_pkts_split :
+                       max_pkt_num_;
+  return pkt_num * this->lidar_const_param_.BLOCKS_PER_PKT * this->lidar_const_param_.CHANNELS_PER_BLOCK;
+}
+
+template <typename T_Point>
+inline void DecoderRSM1<T_Point>::decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx,
+                                                std::vector<T_Point>& vec) const
+{
+  decodeMsopPktImpl(pkt, ctx, vec);
+}
+
+template <typename T_Point>
+inline void DecoderRSM1<T_Point>::decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx,
+                                                PointCloudSoA& cloud) const
+{
+  decodeMsopPktImpl(pkt, ctx, cloud);
+}
+
+template <typename T_Point>
+inline void DecoderRSM1<T_Point>::decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx,
+                                                RowMajorCloud<std::vector<T_Point>>& cloud) const
 {
-  int azimuth = 0;
-  RSDecoderResult ret = decodeMsopPkt(pkt, pointcloud_vec, height, azimuth);
+  decodeMsopPktImpl(pkt, ctx, cloud);
+}
+
+template <typename T_Point>
+inline void DecoderRSM1<T_Point>::decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx,
+                                                RowMajorCloud<PointCloudSoA>& cloud) const
+{
+  decodeMsopPktImpl(pkt, ctx, cloud);
+}
+
+template <typename T_Point>
+inline void DecoderRSM1<T_Point>::decodePacket(const uint8_t* pkt, const PacketContext& ctx,
+                                               CloudSlice<std::vector<T_Point>>& cloud) const
+{
+  decodeMsopPktImpl(pkt, ctx, cloud);
+}
+
+template <typename T_Point>
+inline void DecoderRSM1<T_Point>::decodePacket(const uint8_t* pkt, const PacketContext& ctx,
+                                               CloudSlice<PointCloudSoA>& cloud) const
+{
+  decodeMsopPktImpl(pkt, ctx, cloud);
+}
+
+template <typename T_Point>
+inline void DecoderRSM1<T_Point>::restartFrame()
+{
+  DecoderBase<T_Point>::restartFrame();
+  last_pkt_cnt_ = 1;
+}
+
+template <typename T_Point>
+inline RSDecoderResult DecoderRSM1<T_Point>::prepareMsopPkt(const uint8_t* pkt, PacketContext& ctx)
+{
+  this->updateTransformMatrix(ctx);
+  RSDecoderResult ret = preparePacket(pkt, ctx);
   this->pkt_count_++;
   switch (this->param_.split_frame_mode)
   {
@@ -199,38 +268,53 @@ inline RSDecoderResult DecoderRSM1<T_Point>::processMsopPkt(const uint8_t* pkt,
 }
 
 template <typename T_Point>
-inline RSDecoderResult DecoderRSM1<T_Point>::decodeMsopPkt(const uint8_t* pkt, std::vector<T_Point>& vec, int& height,
-                                                           int& azimuth)
+inline RSDecoderResult DecoderRSM1<T_Point>::preparePacket(const uint8_t* pkt, PacketContext& ctx)
 {
-  height = this->lidar_const_param_.LASER_NUM;
+  ctx.height = this->lidar_const_param_.LASER_NUM;
   RSM1MsopPkt* mpkt_ptr = (RSM1MsopPkt*)pkt;
   if (mpkt_ptr->header.id != this->lidar_const_param_.MSOP_ID)
   {
     return RSDecoderResult::WRONG_PKT_HEADER;
   }
   this->protocol_ver_ = RS_SWAP_SHORT(mpkt_ptr->header.protocol_version);
-  double pkt_timestamp = 0;
   switch (mpkt_ptr->blocks[0].return_seq)
   {
     case 0:
-      pkt_timestamp = this->get_point_time_func_(pkt);
+      ctx.timestamp = this->get_point_time_func_(pkt);
       break;
     case 1:
-      pkt_timestamp = this->get_point_time_func_(pkt);
-      last_pkt_time_ = pkt_timestamp;
+      ctx.timestamp = this->get_point_time_func_(pkt);
+      last_pkt_time_ = ctx.timestamp;
       break;
     case 2:
-      pkt_timestamp = last_pkt_time_;
+      ctx.timestamp = last_pkt_time_;
       break;
   }
+  ctx.point_num = this->lidar_const_param_.BLOCKS_PER_PKT * this->lidar_const_param_.CHANNELS_PER_BLOCK;
+  unsigned int pkt_cnt = RS_SWAP_SHORT(mpkt_ptr->header.pkt_cnt);
+  if (pkt_cnt == max_pkt_num_ || pkt_cnt < last_pkt_cnt_)
+  {
+    last_pkt_cnt_ = 1;
+    return RSDecoderResult::FRAME_SPLIT;
+  }
+  last_pkt_cnt_ = pkt_cnt;
+  return RSDecoderResult::DECODE_OK;
+}
 
+template <typename T_Point>
+template <typename T_Cloud>
+inline void DecoderRSM1<T_Point>::decodeMsopPktImpl(const uint8_t* pkt, const PacketContext& ctx, T_Cloud& cloud) const
+{
+  const RSM1MsopPkt* mpkt_ptr = reinterpret_cast<const RSM1MsopPkt*>(pkt);
   for (size_t blk_idx = 0; blk_idx < this->lidar_const_param_.BLOCKS_PER_PKT; blk_idx++)
   {
     RSM1Block blk = mpkt_ptr->blocks[blk_idx];
-    double point_time = pkt_timestamp + blk.time_offset * 1e-6;
+    double point_time = ctx.timestamp + blk.time_offset * 1e-6;
+    const size_t point_offset = cloud.size();
+    cloud.resize(point_offset + this->lidar_const_param_.CHANNELS_PER_BLOCK);
     for (size_t channel_idx = 0; channel_idx < this->lidar_const_param_.CHANNELS_PER_BLOCK; channel_idx++)
     {
-      T_Point point;
+      auto&& point = getPointRef(cloud, point_offset + channel_idx);
       float distance = RS_SWAP_SHORT(blk.channel[channel_idx].distance) * RS_DIS_RESOLUTION;
       if (distance <= this->param_.max_distance && distance >= this->param_.min_distance)
       {
@@ -240,7 +324,7 @@ inline RSDecoderResult DecoderRSM1<T_Point>::decodeMsopPkt(const uint8_t* pkt, s
         float x = distance * this->checkCosTable(pitch) * this->checkCosTable(yaw);
         float y = distance * this->checkCosTable(pitch) * this->checkSinTable(yaw);
         float z = distance * this->checkSinTable(pitch);
-        this->transformPoint(x, y, z);
+        this->transformPoint(ctx, x, y, z);
         setX(point, x);
         setY(point, y);
         setZ(point, z);
@@ -255,17 +339,8 @@ inline RSDecoderResult DecoderRSM1<T_Point>::decodeMsopPkt(const uint8_t* pkt, s
       }
       setTimestamp(point, point_time);
       setRing(point, channel_idx + 1);
-      vec.emplace_back(std::move(point));
     }
   }
-  unsigned int pkt_cnt = RS_SWAP_SHORT(mpkt_ptr->header.pkt_cnt);
-  if (pkt_cnt == max_pkt_num_ || pkt_cnt < last_pkt_cnt_)
-  {
-    last_pkt_cnt_ = 1;
-    return RSDecoderResult::FRAME_SPLIT;
-  }
-  last_pkt_cnt_ = pkt_cnt;
-  return RSDecoderResult::DECODE_OK;
 }
 
 template <typename T_Point>
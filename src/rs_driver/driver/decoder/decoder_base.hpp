@@ -34,6 +34,9 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rs_driver/common/common_header.h>
 #include <rs_driver/utility/time.h>
 #include <rs_driver/driver/driver_param.h>
+#include <rs_driver/msg/point_cloud_soa_msg.h>
+#include <rs_driver/driver/decoder/row_major_cloud.hpp>
+#include <rs_driver/driver/decoder/cloud_slice.hpp>
 namespace robosense
 {
 namespace lidar
@@ -66,6 +69,7 @@ constexpr float MICRO = 1000000.0;
 constexpr float NANO = 1000000000.0;
 constexpr int RS_ONE_ROUND = 36000;
 constexpr uint16_t PROTOCOL_VER_0 = 0x00;
+constexpr size_t MAX_CHANNELS_PER_BLOCK = 128;
 /* Echo mode definition */
 enum RSEchoMode
 {
@@ -82,6 +86,33 @@ enum RSDecoderResult
   PKT_NULL = -2
 };
 
+/**
+ * @brief What the points of one MSOP packet depend on besides the packet itself. Filled in packet order by
+ * DecoderBase::prepareMsopPkt(), after which the points of the packet can be decoded on any thread
+ */
+struct PacketContext
+{
+  PacketContext() : timestamp(0), point_num(0), azimuth(0), height(1), transform()
+  {
+  }
+  double timestamp;       ///< Time of the first block
+  size_t point_num;       ///< Number of points in the packet, 0 if the packet is not to be decoded
+  int azimuth;            ///< Azimuth of the first block
+  int height;             ///< Number of points in one column
+  float transform[3][4];  ///< Transform matrix in effect for the packet, only filled if ENABLE_TRANSFORM is defined
+};
+
+/**
+ * @brief Output of DecoderBase::decodeBlock(), one entry per channel of a block
+ */
+struct BlockPoints
+{
+  float x[MAX_CHANNELS_PER_BLOCK];
+  float y[MAX_CHANNELS_PER_BLOCK];
+  float z[MAX_CHANNELS_PER_BLOCK];
+  int32_t valid[MAX_CHANNELS_PER_BLOCK];  ///< Non-zero if the channel is in the distance range and the FOV
+};
+
 #pragma pack(push, 1)
 typedef struct
 {
@@ -269,6 +300,23 @@ typedef struct
 
 #pragma pack(pop)
 
+/**
+ * @brief Sine table in 0.01 degree steps, built once and shared by all decoders of the process. It covers 0~450 degree
+ * so that cos(angle) can be read from the same table as sin(angle + 90)
+ */
+inline const std::vector<float>& getSinLookupTable()
+{
+  static const std::vector<float> table = []() {
+    std::vector<float> ret(RS_ONE_ROUND + RS_ONE_ROUND / 4);
+    for (size_t i = 0; i < ret.size(); i++)
+    {
+      ret[i] = static_cast<float>(std::sin(RS_TO_RADS(static_cast<double>(i) * RS_ANGLE_RESOLUTION)));
+    }
+    return ret;
+  }();
+  return table;
+}
+
 //----------------- Decoder ---------------------
 template <typename T_Point>
 class DecoderBase
@@ -279,18 +327,47 @@ public:
   DecoderBase& operator=(const DecoderBase&) = delete;
   virtual ~DecoderBase() = default;
   virtual RSDecoderResult processMsopPkt(const uint8_t* pkt, std::vector<T_Point>& point_cloud_vec, int& height);
+  virtual RSDecoderResult processMsopPkt(const uint8_t* pkt, PointCloudSoA& point_cloud, int& height);
+  virtual RSDecoderResult processMsopPkt(const uint8_t* pkt, RowMajorCloud<std::vector<T_Point>>& point_cloud,
+                                         int& height);
+  virtual RSDecoderResult processMsopPkt(const uint8_t* pkt, RowMajorCloud<PointCloudSoA>& point_cloud, int& height);
+  /**
+   * @brief First half of processMsopPkt(): update the frame splitting state, temperature, camera trigger and so on
+   * with the packet and fill ctx, without decoding any point. Must be called from one thread in packet order
+   */
+  virtual RSDecoderResult prepareMsopPkt(const uint8_t* pkt, PacketContext& ctx);
+  /**
+   * @brief Second half of processMsopPkt(): decode the points of a packet prepared by prepareMsopPkt(). Reads only
+   * the packet, ctx and the calibration, so packets of any frame may be decoded on several threads at once, while
+   * another thread prepares the next packets. Only processDifopPkt() and loadCalibrationFile() must not run meanwhile
+   */
+  virtual void decodePacket(const uint8_t* pkt, const PacketContext& ctx,
+                            CloudSlice<std::vector<T_Point>>& cloud) const = 0;
+  virtual void decodePacket(const uint8_t* pkt, const PacketContext& ctx, CloudSlice<PointCloudSoA>& cloud) const = 0;
   virtual RSDecoderResult processDifopPkt(const uint8_t* pkt);
   virtual void loadCalibrationFile(const std::string& angle_path);
   virtual void regRecvCallback(const std::function<void(const CameraTrigger&)>& callback);  ///< Camera trigger
   virtual double getLidarTemperature();
   virtual double getLidarTime(const uint8_t* pkt) = 0;
+  virtual void setTransformParam(const RSTransformParam& param);  ///< Takes effect from the next prepared packet
+  virtual void setRecvTime(const double& recv_time);  ///< Receive time of the next prepared packet, 0 if unknown
+  virtual size_t getMaxPointsPerFrame();                          ///< Used to preallocate the frame buffers
+  virtual void restartFrame();  ///< Reset the frame splitting state, so that the next packet starts a new frame
+  size_t getHeight();                                             ///< Number of points in one column of a frame
 
 protected:
   virtual float computeTemperature(const uint16_t& temp_raw);
   virtual float computeTemperature(const uint8_t& temp_low, const uint8_t& temp_high);
   virtual int azimuthCalibration(const float& azimuth, const int& channel);
   virtual void checkTriggerAngle(const int& angle, const double& timestamp);
-  virtual RSDecoderResult decodeMsopPkt(const uint8_t* pkt, std::vector<T_Point>& vec, int& height, int& azimuth) = 0;
+  double getRecvTime() const;  ///< Receive time of the packet being prepared, or the current time if unknown
+  virtual RSDecoderResult preparePacket(const uint8_t* pkt, PacketContext& ctx) = 0;  ///< Header check & state
+  virtual void decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx, std::vector<T_Point>& vec) const = 0;
+  virtual void decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx, PointCloudSoA& cloud) const = 0;
+  virtual void decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx,
+                             RowMajorCloud<std::vector<T_Point>>& cloud) const = 0;
+  virtual void decodeMsopPkt(const uint8_t* pkt, const PacketContext& ctx,
+                             RowMajorCloud<PointCloudSoA>& cloud) const = 0;
   virtual RSDecoderResult decodeDifopPkt(const uint8_t* pkt) = 0;
   RSEchoMode getEchoMode(const LidarType& type, const uint8_t& return_mode);
   template <typename T_Msop>
@@ -301,13 +378,15 @@ protected:
   void decodeDifopCommon(const uint8_t* pkt, const LidarType& type);
   template <typename T_Difop>
   void decodeDifopCalibration(const uint8_t* pkt, const LidarType& type);
-  void transformPoint(float& x, float& y, float& z);
-  float checkCosTable(const int& angle);
-  float checkSinTable(const int& angle);
+  void transformPoint(const PacketContext& ctx, float& x, float& y, float& z) const;
+  void updateTransformMatrix(PacketContext& ctx);  ///< Apply setTransformParam() and pass the matrix on to ctx
+  float checkCosTable(const int& angle) const;
+  float checkSinTable(const int& angle) const;
   void sortBeamTable();
-
-private:
-  std::vector<double> initTrigonometricLookupTable(const std::function<double(const double)>& func);
+  void buildChannelTable();
+  virtual float getChannelAzimuthFactor(const size_t& channel);
+  void decodeBlock(const PacketContext& ctx, const RSChannel* channels, const int& azimuth, const float& azi_diff,
+                   const float& dis_resolution, BlockPoints& block) const;
 
 protected:
   const LidarConstantParameter lidar_const_param_;
@@ -329,16 +408,37 @@ protected:
   float time_duration_between_blocks_;
   float current_temperature_;
   float azi_diff_between_block_theoretical_;
+  double recv_time_;
   std::vector<int> vert_angle_list_;
   std::vector<int> hori_angle_list_;
   std::vector<uint16_t> beam_ring_table_;
+  std::vector<float> chan_azi_factor_;  ///< Azimuth offset of each channel in a block, in units of azi_diff
+  std::vector<int> chan_hori_angle_;    ///< Horizontal calibration angle of each channel in a block
+  std::vector<float> chan_vert_cos_;    ///< cos() of the vertical angle of each channel in a block
+  std::vector<float> chan_vert_sin_;    ///< sin() of the vertical angle of each channel in a block
   std::vector<std::function<void(const CameraTrigger&)>> camera_trigger_cb_vec_;
   std::function<double(const uint8_t*)> get_point_time_func_;
   std::function<void(const int&, const uint8_t*)> check_camera_trigger_func_;
 
 private:
-  std::vector<double> cos_lookup_table_;
-  std::vector<double> sin_lookup_table_;
+  template <typename T_Cloud>
+  RSDecoderResult processMsopPktImpl(const uint8_t* pkt, T_Cloud& point_cloud, int& height);
+  void buildTransformMatrix(const RSTransformParam& param);
+  void decodeBlockScalar(const PacketContext& ctx, const RSChannel* channels, const int& azimuth,
+                         const float& azi_diff, const float& dis_resolution, const size_t& start_idx,
+                         BlockPoints& block) const;
+#ifdef RS_ENABLE_AVX2_KERNEL
+  size_t decodeBlockAVX2(const PacketContext& ctx, const RSChannel* channels, const int& azimuth,
+                         const float& azi_diff, const float& dis_resolution, BlockPoints& block) const;
+#endif
+
+private:
+  const float* sin_lookup_table_;  ///< Points to the shared table of getSinLookupTable()
+  float transform_matrix_[3][4];   ///< Rotation and translation built from param_.transform_param
+  bool use_avx2_;                  ///< The CPU supports AVX2 and FMA, and param_.use_simd is set
+  std::atomic<bool> transform_param_changed_;
+  std::mutex transform_mutex_;
+  RSTransformParam pending_transform_param_;
 };
 
 template <typename T_Point>
@@ -362,6 +462,9 @@ inline DecoderBase<T_Point>::DecoderBase(const RSDecoderParam& param, const Lida
   , time_duration_between_blocks_(0)
   , current_temperature_(0)
   , azi_diff_between_block_theoretical_(20)
+  , recv_time_(0)
+  , sin_lookup_table_(getSinLookupTable().data())
+  , transform_param_changed_(false)
 {
   if (cut_angle_ > RS_ONE_ROUND)
   {
@@ -380,24 +483,17 @@ inline DecoderBase<T_Point>::DecoderBase(const RSDecoderParam& param, const Lida
   }
 
   /* Point time function*/
-  if (RS_HAS_MEMBER(T_Point, timestamp))  ///< return the timestamp of the first block in one packet
+  if (this->param_.use_lidar_clock)  ///< return the timestamp of the first block in one packet
   {
-    if (this->param_.use_lidar_clock)
-    {
-      get_point_time_func_ = [this](const uint8_t* pkt) { return getLidarTime(pkt); };
-    }
-    else
-    {
-      get_point_time_func_ = [this](const uint8_t* pkt) {
-        double ret_time =
-            getTime() - (this->lidar_const_param_.BLOCKS_PER_PKT - 1) * this->time_duration_between_blocks_;
-        return ret_time;
-      };
-    }
+    get_point_time_func_ = [this](const uint8_t* pkt) { return getLidarTime(pkt); };
   }
   else
   {
-    get_point_time_func_ = [this](const uint8_t* pkt) { return 0; };
+    get_point_time_func_ = [this](const uint8_t* pkt) {
+      double ret_time =
+          getRecvTime() - (this->lidar_const_param_.BLOCKS_PER_PKT - 1) * this->time_duration_between_blocks_;
+      return ret_time;
+    };
   }
   /*Camera trigger function*/
   if (param.trigger_param.trigger_map.size() != 0)
@@ -411,7 +507,7 @@ inline DecoderBase<T_Point>::DecoderBase(const RSDecoderParam& param, const Lida
     else
     {
       check_camera_trigger_func_ = [this](const int& azimuth, const uint8_t* pkt) {
-        checkTriggerAngle(azimuth, getTime());
+        checkTriggerAngle(azimuth, getRecvTime());
       };
     }
   }
@@ -420,9 +516,16 @@ inline DecoderBase<T_Point>::DecoderBase(const RSDecoderParam& param, const Lida
     check_camera_trigger_func_ = [this](const int& azimuth, const uint8_t* pkt) { return; };
   }
 
-  /* Cos & Sin look-up table*/
-  cos_lookup_table_ = initTrigonometricLookupTable([](const double rad) -> double { return std::cos(rad); });
-  sin_lookup_table_ = initTrigonometricLookupTable([](const double rad) -> double { return std::sin(rad); });
+  chan_azi_factor_.resize(lidar_const_param_.CHANNELS_PER_BLOCK, 0.0f);
+  chan_hori_angle_.resize(lidar_const_param_.CHANNELS_PER_BLOCK, 0);
+  chan_vert_cos_.resize(lidar_const_param_.CHANNELS_PER_BLOCK, 1.0f);
+  chan_vert_sin_.resize(lidar_const_param_.CHANNELS_PER_BLOCK, 0.0f);
+#ifdef RS_ENABLE_AVX2_KERNEL
+  use_avx2_ = param.use_simd && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+  use_avx2_ = false;
+#endif
+  buildTransformMatrix(param_.transform_param);
 }
 
 template <typename T_Point>
@@ -438,13 +541,58 @@ inline RSDecoderResult DecoderBase<T_Point>::processDifopPkt(const uint8_t* pkt)
 template <typename T_Point>
 inline RSDecoderResult DecoderBase<T_Point>::processMsopPkt(const uint8_t* pkt, std::vector<T_Point>& point_cloud_vec,
                                                             int& height)
+{
+  return processMsopPktImpl(pkt, point_cloud_vec, height);
+}
+
+template <typename T_Point>
+inline RSDecoderResult DecoderBase<T_Point>::processMsopPkt(const uint8_t* pkt, PointCloudSoA& point_cloud, int& height)
+{
+  return processMsopPktImpl(pkt, point_cloud, height);
+}
+
+template <typename T_Point>
+inline RSDecoderResult DecoderBase<T_Point>::processMsopPkt(const uint8_t* pkt,
+                                                            RowMajorCloud<std::vector<T_Point>>& point_cloud,
+                                                            int& height)
+{
+  return processMsopPktImpl(pkt, point_cloud, height);
+}
+
+template <typename T_Point>
+inline RSDecoderResult DecoderBase<T_Point>::processMsopPkt(const uint8_t* pkt,
+                                                            RowMajorCloud<PointCloudSoA>& point_cloud, int& height)
+{
+  return processMsopPktImpl(pkt, point_cloud, height);
+}
+
+template <typename T_Point>
+template <typename T_Cloud>
+inline RSDecoderResult DecoderBase<T_Point>::processMsopPktImpl(const uint8_t* pkt, T_Cloud& point_cloud, int& height)
+{
+  PacketContext ctx;
+  RSDecoderResult ret = prepareMsopPkt(pkt, ctx);
+  if (ret == PKT_NULL)
+  {
+    return ret;
+  }
+  height = ctx.height;
+  if (ctx.point_num != 0)
+  {
+    decodeMsopPkt(pkt, ctx, point_cloud);
+  }
+  return ret;
+}
+
+template <typename T_Point>
+inline RSDecoderResult DecoderBase<T_Point>::prepareMsopPkt(const uint8_t* pkt, PacketContext& ctx)
 {
   if (pkt == NULL)
   {
     return PKT_NULL;
   }
-  int azimuth = 0;
-  RSDecoderResult ret = decodeMsopPkt(pkt, point_cloud_vec, height, azimuth);
+  updateTransformMatrix(ctx);
+  RSDecoderResult ret = preparePacket(pkt, ctx);
   if (ret != RSDecoderResult::DECODE_OK)
   {
     return ret;
@@ -453,19 +601,19 @@ inline RSDecoderResult DecoderBase<T_Point>::processMsopPkt(const uint8_t* pkt,
   switch (this->param_.split_frame_mode)
   {
     case SplitFrameMode::SPLIT_BY_ANGLE:
-      if (azimuth < this->last_azimuth_)
+      if (ctx.azimuth < this->last_azimuth_)
       {
         this->last_azimuth_ -= RS_ONE_ROUND;
       }
-      if (this->last_azimuth_ != -36001 && this->last_azimuth_ < this->cut_angle_ && azimuth >= this->cut_angle_)
+      if (this->last_azimuth_ != -36001 && this->last_azimuth_ < this->cut_angle_ && ctx.azimuth >= this->cut_angle_)
       {
-        this->last_azimuth_ = azimuth;
+        this->last_azimuth_ = ctx.azimuth;
         this->pkt_count_ = 0;
         this->trigger_index_ = 0;
         this->prev_angle_diff_ = RS_ONE_ROUND;
         return FRAME_SPLIT;
       }
-      this->last_azimuth_ = azimuth;
+      this->last_azimuth_ = ctx.azimuth;
       break;
     case SplitFrameMode::SPLIT_BY_FIXED_PKTS:
       if (this->pkt_count_ >= this->pkts_per_frame_)
@@ -491,6 +639,44 @@ inline RSDecoderResult DecoderBase<T_Point>::processMsopPkt(const uint8_t* pkt,
   return DECODE_OK;
 }
 
+template <typename T_Point>
+inline void DecoderBase<T_Point>::restartFrame()
+{
+  this->pkt_count_ = 0;
+  this->trigger_index_ = 0;
+  this->prev_angle_diff_ = RS_ONE_ROUND;
+  this->last_azimuth_ = -36001;
+}
+
+template <typename T_Point>
+inline size_t DecoderBase<T_Point>::getMaxPointsPerFrame()
+{
+  size_t pkt_num = (this->param_.split_frame_mode == SplitFrameMode::SPLIT_BY_CUSTOM_PKTS) ?
+                       this->param_.num_pkts_split :
+                       this->pkts_per_frame_ + 1;  ///< One more packet since a frame split by angle may be a bit longer
+  return pkt_num * this->lidar_const_param_.BLOCKS_PER_PKT * this->lidar_const_param_.CHANNELS_PER_BLOCK;
+}
+
+template <typename T_Point>
+inline size_t DecoderBase<T_Point>::getHeight()
+{
+  return this->lidar_const_param_.LASER_NUM;
+}
+
+template <typename T_Point>
+inline void DecoderBase<T_Point>::setTransformParam(const RSTransformParam& param)
+{
+  std::lock_guard<std::mutex> lock(transform_mutex_);
+  pending_transform_param_ = param;
+  transform_param_changed_.store(true);
+}
+
+template <typename T_Point>
+inline void DecoderBase<T_Point>::setRecvTime(const double& recv_time)
+{
+  recv_time_ = recv_time;
+}
+
 template <typename T_Point>
 inline void DecoderBase<T_Point>::regRecvCallback(const std::function<void(const CameraTrigger&)>& callback)
 {
@@ -534,6 +720,7 @@ inline void DecoderBase<T_Point>::loadCalibrationFile(const std::string& angle_p
       if (row_index >= this->lidar_const_param_.LASER_NUM)
       {
         this->sortBeamTable();
+        this->buildChannelTable();
         break;
       }
     }
@@ -541,6 +728,12 @@ inline void DecoderBase<T_Point>::loadCalibrationFile(const std::string& angle_p
   }
 }
 
+template <typename T_Point>
+inline double DecoderBase<T_Point>::getRecvTime() const
+{
+  return recv_time_ > 0 ? recv_time_ : getTime();
+}
+
 template <typename T_Point>
 inline void DecoderBase<T_Point>::checkTriggerAngle(const int& angle, const double& timestamp)
 {
@@ -620,7 +813,12 @@ template <typename T_Difop>
 inline void DecoderBase<T_Point>::decodeDifopCommon(const uint8_t* pkt, const LidarType& type)
 {
   const T_Difop* dpkt_ptr = reinterpret_cast<const T_Difop*>(pkt);
-  this->echo_mode_ = this->getEchoMode(type, dpkt_ptr->return_mode);
+  RSEchoMode echo_mode = this->getEchoMode(type, dpkt_ptr->return_mode);
+  if (echo_mode != this->echo_mode_)
+  {
+    this->echo_mode_ = echo_mode;
+    this->buildChannelTable();
+  }
   this->rpm_ = RS_SWAP_SHORT(dpkt_ptr->rpm);
   if (this->rpm_ == 0)
   {
@@ -678,6 +876,7 @@ inline void DecoderBase<T_Point>::decodeDifopCalibration(const uint8_t* pkt, con
     }
   }
   this->sortBeamTable();
+  this->buildChannelTable();
   this->difop_flag_ = true;
 }
 
@@ -731,23 +930,55 @@ inline double DecoderBase<T_Point>::calculateTimeYMD(const uint8_t* pkt)
 }
 
 template <typename T_Point>
-inline void DecoderBase<T_Point>::transformPoint(float& x, float& y, float& z)
+inline void DecoderBase<T_Point>::transformPoint(const PacketContext& ctx, float& x, float& y, float& z) const
 {
 #ifdef ENABLE_TRANSFORM
-  Eigen::AngleAxisd current_rotation_x(param_.transform_param.roll, Eigen::Vector3d::UnitX());
-  Eigen::AngleAxisd current_rotation_y(param_.transform_param.pitch, Eigen::Vector3d::UnitY());
-  Eigen::AngleAxisd current_rotation_z(param_.transform_param.yaw, Eigen::Vector3d::UnitZ());
-  Eigen::Translation3d current_translation(param_.transform_param.x, param_.transform_param.y,
-                                           param_.transform_param.z);
-  Eigen::Matrix4d trans = (current_translation * current_rotation_z * current_rotation_y * current_rotation_x).matrix();
-  Eigen::Vector4d target_ori(x, y, z, 1);
-  Eigen::Vector4d target_rotate = trans * target_ori;
-  x = target_rotate(0);
-  y = target_rotate(1);
-  z = target_rotate(2);
+  const float px = x;
+  const float py = y;
+  const float pz = z;
+  x = ctx.transform[0][0] * px + ctx.transform[0][1] * py + ctx.transform[0][2] * pz + ctx.transform[0][3];
+  y = ctx.transform[1][0] * px + ctx.transform[1][1] * py + ctx.transform[1][2] * pz + ctx.transform[1][3];
+  z = ctx.transform[2][0] * px + ctx.transform[2][1] * py + ctx.transform[2][2] * pz + ctx.transform[2][3];
 #endif
 }
 
+template <typename T_Point>
+inline void DecoderBase<T_Point>::updateTransformMatrix(PacketContext& ctx)
+{
+  if (transform_param_changed_.load(std::memory_order_relaxed))
+  {
+    std::lock_guard<std::mutex> lock(transform_mutex_);
+    param_.transform_param = pending_transform_param_;
+    buildTransformMatrix(param_.transform_param);
+    transform_param_changed_.store(false);
+  }
+#ifdef ENABLE_TRANSFORM
+  memcpy(ctx.transform, transform_matrix_, sizeof(transform_matrix_));
+#endif
+}
+
+template <typename T_Point>
+inline void DecoderBase<T_Point>::buildTransformMatrix(const RSTransformParam& param)
+{
+  /* translation * yaw(z) * pitch(y) * roll(x) */
+  const double cr = std::cos(param.roll);
+  const double sr = std::sin(param.roll);
+  const double cp = std::cos(param.pitch);
+  const double sp = std::sin(param.pitch);
+  const double cy = std::cos(param.yaw);
+  const double sy = std::sin(param.yaw);
+  const double matrix[3][4] = { { cy * cp, cy * sp * sr - sy * cr, cy * sp * cr + sy * sr, param.x },
+                                { sy * cp, sy * sp * sr + cy * cr, sy * sp * cr - cy * sr, param.y },
+                                { -sp, cp * sr, cp * cr, param.z } };
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 4; j++)
+    {
+      transform_matrix_[i][j] = static_cast<float>(matrix[i][j]);
+    }
+  }
+}
+
 template <typename T_Point>
 inline void DecoderBase<T_Point>::sortBeamTable()
 {
@@ -762,6 +993,179 @@ inline void DecoderBase<T_Point>::sortBeamTable()
   }
 }
 
+template <typename T_Point>
+inline float DecoderBase<T_Point>::getChannelAzimuthFactor(const size_t& channel)
+{
+  return 0.0f;
+}
+
+template <typename T_Point>
+inline void DecoderBase<T_Point>::buildChannelTable()
+{
+  if (this->vert_angle_list_.size() < this->lidar_const_param_.LASER_NUM ||
+      this->hori_angle_list_.size() < this->lidar_const_param_.LASER_NUM)
+  {
+    return;
+  }
+  for (size_t i = 0; i < this->lidar_const_param_.CHANNELS_PER_BLOCK; i++)
+  {
+    size_t laser_idx = i % this->lidar_const_param_.LASER_NUM;
+    int angle_vert = (this->vert_angle_list_[laser_idx] + RS_ONE_ROUND) % RS_ONE_ROUND;
+    this->chan_azi_factor_[i] = getChannelAzimuthFactor(i);
+    this->chan_hori_angle_[i] = this->hori_angle_list_[laser_idx];
+    this->chan_vert_cos_[i] = checkCosTable(angle_vert);
+    this->chan_vert_sin_[i] = checkSinTable(angle_vert);
+  }
+}
+
+/**
+ * @brief Compute the coordinates of all channels of one block into block, transformed by the matrix of ctx if
+ * ENABLE_TRANSFORM is defined.
+ * channels must be followed by at least one more byte in the packet, which holds for all mechanical LiDARs
+ */
+template <typename T_Point>
+inline void DecoderBase<T_Point>::decodeBlock(const PacketContext& ctx, const RSChannel* channels, const int& azimuth,
+                                              const float& azi_diff, const float& dis_resolution,
+                                              BlockPoints& block) const
+{
+  size_t start_idx = 0;
+#ifdef RS_ENABLE_AVX2_KERNEL
+  if (use_avx2_)
+  {
+    start_idx = decodeBlockAVX2(ctx, channels, azimuth, azi_diff, dis_resolution, block);
+  }
+#endif
+  decodeBlockScalar(ctx, channels, azimuth, azi_diff, dis_resolution, start_idx, block);
+}
+
+template <typename T_Point>
+inline void DecoderBase<T_Point>::decodeBlockScalar(const PacketContext& ctx, const RSChannel* channels,
+                                                    const int& azimuth, const float& azi_diff,
+                                                    const float& dis_resolution, const size_t& start_idx,
+                                                    BlockPoints& block) const
+{
+  for (size_t i = start_idx; i < this->lidar_const_param_.CHANNELS_PER_BLOCK; i++)
+  {
+    float azi_channel_ori = azimuth + azi_diff * chan_azi_factor_[i];
+    int azi_channel_final = (static_cast<int>(azi_channel_ori) + chan_hori_angle_[i] + RS_ONE_ROUND) % RS_ONE_ROUND;
+    int angle_horiz = static_cast<int>(azi_channel_ori + RS_ONE_ROUND) % RS_ONE_ROUND;
+    float distance = RS_SWAP_SHORT(channels[i].distance) * dis_resolution;
+    block.valid[i] =
+        (distance <= param_.max_distance && distance >= param_.min_distance) &&
+        ((angle_flag_ && azi_channel_final >= start_angle_ && azi_channel_final <= end_angle_) ||
+         (!angle_flag_ && ((azi_channel_final >= start_angle_) || (azi_channel_final <= end_angle_))));
+    float xy = distance * chan_vert_cos_[i];
+    block.x[i] = xy * checkCosTable(azi_channel_final) + lidar_const_param_.RX * checkCosTable(angle_horiz);
+    block.y[i] = -xy * checkSinTable(azi_channel_final) - lidar_const_param_.RX * checkSinTable(angle_horiz);
+    block.z[i] = distance * chan_vert_sin_[i] + lidar_const_param_.RZ;
+    transformPoint(ctx, block.x[i], block.y[i], block.z[i]);
+  }
+}
+
+#ifdef RS_ENABLE_AVX2_KERNEL
+/**
+ * @brief Subtract one round from the angles which are not less than one round
+ */
+__attribute__((target("avx2"))) inline __m256i wrapAngleAVX2(const __m256i& angle)
+{
+  const __m256i one_round = _mm256_set1_epi32(RS_ONE_ROUND);
+  const __m256i one_round_max = _mm256_set1_epi32(RS_ONE_ROUND - 1);
+  return _mm256_sub_epi32(angle, _mm256_and_si256(_mm256_cmpgt_epi32(angle, one_round_max), one_round));
+}
+
+/**
+ * @brief AVX2 version of decodeBlockScalar(), 8 channels per iteration. The distances are fetched with a gather at
+ * a stride of sizeof(RSChannel) and byte swapped in the vector; the trigonometric values are gathered from the shared
+ * sine table. The transform is applied in the registers with the matrix broadcast once per block. Returns the number
+ * of channels done, the rest is left to the scalar version
+ */
+template <typename T_Point>
+__attribute__((target("avx2,fma"))) inline size_t
+DecoderBase<T_Point>::decodeBlockAVX2(const PacketContext& ctx, const RSChannel* channels, const int& azimuth,
+                                      const float& azi_diff, const float& dis_resolution, BlockPoints& block) const
+{
+  const size_t num = this->lidar_const_param_.CHANNELS_PER_BLOCK & ~static_cast<size_t>(7);
+  const uint8_t* base = reinterpret_cast<const uint8_t*>(channels);
+  const float* table = sin_lookup_table_;
+  const __m256i offset = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+  const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+  const __m256i one_round = _mm256_set1_epi32(RS_ONE_ROUND);
+  const __m256i quarter_round = _mm256_set1_epi32(RS_ONE_ROUND / 4);
+  const __m256i start_angle = _mm256_set1_epi32(start_angle_);
+  const __m256i end_angle = _mm256_set1_epi32(end_angle_);
+  const __m256 one_round_ps = _mm256_set1_ps(static_cast<float>(RS_ONE_ROUND));
+  const __m256 azimuth_ps = _mm256_set1_ps(static_cast<float>(azimuth));
+  const __m256 azi_diff_ps = _mm256_set1_ps(azi_diff);
+  const __m256 resolution = _mm256_set1_ps(dis_resolution);
+  const __m256 min_distance = _mm256_set1_ps(param_.min_distance);
+  const __m256 max_distance = _mm256_set1_ps(param_.max_distance);
+  const __m256 rx = _mm256_set1_ps(lidar_const_param_.RX);
+  const __m256 rz = _mm256_set1_ps(lidar_const_param_.RZ);
+  const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+#ifdef ENABLE_TRANSFORM
+  __m256 matrix[3][4];
+  for (size_t row = 0; row < 3; row++)
+  {
+    for (size_t col = 0; col < 4; col++)
+    {
+      matrix[row][col] = _mm256_set1_ps(ctx.transform[row][col]);
+    }
+  }
+#endif
+
+  for (size_t i = 0; i < num; i += 8)
+  {
+    /* distance: gather 4 bytes per channel, swap the 2 big-endian bytes and scale */
+    __m256i raw = _mm256_i32gather_epi32(reinterpret_cast<const int*>(base + i * sizeof(RSChannel)), offset, 1);
+    __m256i dis_raw = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(raw, byte_mask), 8),
+                                      _mm256_and_si256(_mm256_srli_epi32(raw, 8), byte_mask));
+    __m256 distance = _mm256_mul_ps(_mm256_cvtepi32_ps(dis_raw), resolution);
+
+    /* azimuth of each channel, truncated like static_cast<int> */
+    __m256 azi_ori = _mm256_add_ps(azimuth_ps, _mm256_mul_ps(azi_diff_ps, _mm256_loadu_ps(&chan_azi_factor_[i])));
+    __m256i azi_final = _mm256_add_epi32(_mm256_cvttps_epi32(azi_ori),
+                                         _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&chan_hori_angle_[i])));
+    azi_final = wrapAngleAVX2(wrapAngleAVX2(_mm256_add_epi32(azi_final, one_round)));
+    __m256i angle_horiz = wrapAngleAVX2(wrapAngleAVX2(_mm256_cvttps_epi32(_mm256_add_ps(azi_ori, one_round_ps))));
+
+    /* distance range & FOV */
+    __m256i in_range = _mm256_castps_si256(_mm256_and_ps(_mm256_cmp_ps(distance, max_distance, _CMP_LE_OQ),
+                                                         _mm256_cmp_ps(distance, min_distance, _CMP_GE_OQ)));
+    __m256i before_start = _mm256_cmpgt_epi32(start_angle, azi_final);
+    __m256i after_end = _mm256_cmpgt_epi32(azi_final, end_angle);
+    __m256i out_fov =
+        angle_flag_ ? _mm256_or_si256(before_start, after_end) : _mm256_and_si256(before_start, after_end);
+    __m256i valid = _mm256_andnot_si256(out_fov, in_range);
+
+    /* coordinates */
+    __m256 cos_final = _mm256_i32gather_ps(table, _mm256_add_epi32(azi_final, quarter_round), 4);
+    __m256 sin_final = _mm256_i32gather_ps(table, azi_final, 4);
+    __m256 cos_horiz = _mm256_i32gather_ps(table, _mm256_add_epi32(angle_horiz, quarter_round), 4);
+    __m256 sin_horiz = _mm256_i32gather_ps(table, angle_horiz, 4);
+    __m256 xy = _mm256_mul_ps(distance, _mm256_loadu_ps(&chan_vert_cos_[i]));
+    __m256 x = _mm256_fmadd_ps(xy, cos_final, _mm256_mul_ps(rx, cos_horiz));
+    __m256 y = _mm256_xor_ps(_mm256_fmadd_ps(xy, sin_final, _mm256_mul_ps(rx, sin_horiz)), sign_mask);
+    __m256 z = _mm256_fmadd_ps(distance, _mm256_loadu_ps(&chan_vert_sin_[i]), rz);
+#ifdef ENABLE_TRANSFORM
+    __m256 coord[3];
+    for (size_t row = 0; row < 3; row++)
+    {
+      __m256 sum = _mm256_fmadd_ps(matrix[row][2], z, matrix[row][3]);
+      coord[row] = _mm256_fmadd_ps(matrix[row][0], x, _mm256_fmadd_ps(matrix[row][1], y, sum));
+    }
+    x = coord[0];
+    y = coord[1];
+    z = coord[2];
+#endif
+    _mm256_storeu_ps(&block.x[i], x);
+    _mm256_storeu_ps(&block.y[i], y);
+    _mm256_storeu_ps(&block.z[i], z);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&block.valid[i]), valid);
+  }
+  return num;
+}
+#endif
+
 template <typename T_Point>
 inline typename std::enable_if<!RS_HAS_MEMBER(T_Point, x)>::type setX(T_Point& point, const float& value)
 {
@@ -832,6 +1236,64 @@ inline typename std::enable_if<RS_HAS_MEMBER(T_Point, timestamp)>::type setTimes
   point.timestamp = value;
 }
 
+inline void setX(PointCloudSoARef& point, const float& value)
+{
+  point.cloud.x[point.idx] = value;
+}
+
+inline void setY(PointCloudSoARef& point, const float& value)
+{
+  point.cloud.y[point.idx] = value;
+}
+
+inline void setZ(PointCloudSoARef& point, const float& value)
+{
+  point.cloud.z[point.idx] = value;
+}
+
+inline void setIntensity(PointCloudSoARef& point, const uint8_t& value)
+{
+  point.cloud.intensity[point.idx] = value;
+}
+
+inline void setRing(PointCloudSoARef& point, const uint16_t& value)
+{
+  point.cloud.ring[point.idx] = value;
+}
+
+inline void setTimestamp(PointCloudSoARef& point, const double& value)
+{
+  point.cloud.timestamp[point.idx] = value;
+}
+
+/**
+ * @brief Get the point at idx of a decoder output, which is either a std::vector<T_Point> or a PointCloudSoA. The
+ * result is meant to be bound to an auto&& and filled with setX(), setY() ...
+ */
+template <typename T_Point>
+inline T_Point& getPointRef(std::vector<T_Point>& vec, const size_t& idx)
+{
+  return vec[idx];
+}
+
+inline PointCloudSoARef getPointRef(PointCloudSoA& cloud, const size_t& idx)
+{
+  return PointCloudSoARef{ cloud, idx };
+}
+
+template <typename T_Cloud>
+inline auto getPointRef(RowMajorCloud<T_Cloud>& cloud, const size_t& idx)
+    -> decltype(getPointRef(cloud.tile(), idx))
+{
+  return getPointRef(cloud.tile(), cloud.index(idx));
+}
+
+template <typename T_Cloud>
+inline auto getPointRef(CloudSlice<T_Cloud>& cloud, const size_t& idx) -> decltype(getPointRef(cloud.cloud(), idx))
+{
+  return getPointRef(cloud.cloud(), cloud.index(idx));
+}
+
 template <typename T_Point>
 inline RSEchoMode DecoderBase<T_Point>::getEchoMode(const LidarType& type, const uint8_t& return_mode)
 {
@@ -874,27 +1336,14 @@ inline RSEchoMode DecoderBase<T_Point>::getEchoMode(const LidarType& type, const
 }
 
 template <typename T_Point>
-inline float DecoderBase<T_Point>::checkCosTable(const int& angle)
+inline float DecoderBase<T_Point>::checkCosTable(const int& angle) const
 {
-  return cos_lookup_table_[angle + RS_ONE_ROUND];
+  return sin_lookup_table_[(angle < 0 ? angle + RS_ONE_ROUND : angle) + RS_ONE_ROUND / 4];
 }
 template <typename T_Point>
-inline float DecoderBase<T_Point>::checkSinTable(const int& angle)
+inline float DecoderBase<T_Point>::checkSinTable(const int& angle) const
 {
-  return sin_lookup_table_[angle + RS_ONE_ROUND];
-}
-
-template <typename T_Point>
-inline std::vector<double>
-DecoderBase<T_Point>::initTrigonometricLookupTable(const std::function<double(const double)>& func)
-{
-  std::vector<double> temp_table = std::vector<double>(2 * RS_ONE_ROUND, 0.0);
-  for (int i = 0; i < 2 * RS_ONE_ROUND; i++)
-  {
-    const double rad = RS_TO_RADS(static_cast<double>(i - RS_ONE_ROUND) * RS_ANGLE_RESOLUTION);
-    temp_table[i] = func(rad);
-  }
-  return temp_table;
+  return sin_lookup_table_[angle < 0 ? angle + RS_ONE_ROUND : angle];
 }
 
 }  // namespace lidar
@@ -0,0 +1,217 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+#include <rs_driver/common/common_header.h>
+#include <rs_driver/msg/point_cloud_soa_msg.h>
+namespace robosense
+{
+namespace lidar
+{
+/**
+ * @brief Move the first num points of each row of a row-major frame from a row stride of old_stride to new_stride
+ */
+template <typename T>
+inline void moveRows(std::vector<T>& vec, const size_t& height, const size_t& old_stride, const size_t& new_stride,
+                     const size_t& num)
+{
+  if (new_stride > old_stride)
+  {
+    for (size_t row = height - 1; row > 0; row--)
+    {
+      std::move_backward(vec.begin() + row * old_stride, vec.begin() + row * old_stride + num,
+                         vec.begin() + row * new_stride + num);
+    }
+  }
+  else if (new_stride < old_stride)
+  {
+    for (size_t row = 1; row < height; row++)
+    {
+      std::move(vec.begin() + row * old_stride, vec.begin() + row * old_stride + num, vec.begin() + row * new_stride);
+    }
+  }
+}
+
+inline void moveRows(PointCloudSoA& cloud, const size_t& height, const size_t& old_stride, const size_t& new_stride,
+                     const size_t& num)
+{
+  moveRows(cloud.x, height, old_stride, new_stride, num);
+  moveRows(cloud.y, height, old_stride, new_stride, num);
+  moveRows(cloud.z, height, old_stride, new_stride, num);
+  moveRows(cloud.intensity, height, old_stride, new_stride, num);
+  moveRows(cloud.ring, height, old_stride, new_stride, num);
+  moveRows(cloud.timestamp, height, old_stride, new_stride, num);
+}
+
+/**
+ * @brief Copy num points, stored column by column in tile, into the rows of a row-major frame starting at column col
+ */
+template <typename T>
+inline void copyTileToRows(const std::vector<T>& tile, const size_t& height, const size_t& num, std::vector<T>& vec,
+                           const size_t& stride, const size_t& col)
+{
+  size_t full_cols = num / height;
+  size_t rest = num % height;
+  for (size_t row = 0; row < height; row++)
+  {
+    const T* src = tile.data() + row;
+    T* dst = vec.data() + row * stride + col;
+    size_t cols = full_cols + (row < rest ? 1 : 0);
+    for (size_t i = 0; i < cols; i++)
+    {
+      dst[i] = src[i * height];
+    }
+  }
+}
+
+inline void copyTileToRows(const PointCloudSoA& tile, const size_t& height, const size_t& num, PointCloudSoA& cloud,
+                           const size_t& stride, const size_t& col)
+{
+  copyTileToRows(tile.x, height, num, cloud.x, stride, col);
+  copyTileToRows(tile.y, height, num, cloud.y, stride, col);
+  copyTileToRows(tile.z, height, num, cloud.z, stride, col);
+  copyTileToRows(tile.intensity, height, num, cloud.intensity, stride, col);
+  copyTileToRows(tile.ring, height, num, cloud.ring, stride, col);
+  copyTileToRows(tile.timestamp, height, num, cloud.timestamp, stride, col);
+}
+
+/**
+ * @brief Decoder output which builds a row-major frame in place. The decoders append the points column by column as
+ * usual into a small tile of a few columns, and each full tile is copied into its columns of the underlying cloud,
+ * which is sized to height * stride points. Copying a tile at a time keeps the writes into each row contiguous instead
+ * of scattering every column over all rows. If the frame turns out wider than the stride, the rows are moved apart
+ * once; if it turns out narrower, finish() closes up the rows. So no frame-sized second buffer is needed.
+ * @note T_Cloud is std::vector<T_Point> or PointCloudSoA
+ */
+template <typename T_Cloud>
+class RowMajorCloud
+{
+public:
+  static constexpr size_t TILE_COLS = 8;  ///< Columns collected before they are copied into the rows
+
+  inline RowMajorCloud() : cloud_(nullptr), height_(1), stride_(0), max_stride_(0), point_num_(0), tile_col_(0)
+  {
+  }
+
+  /**
+   * @brief Start a new frame in cloud
+   * @param height Number of rows
+   * @param stride Expected number of columns, e.g. the width of the previous frame
+   * @param max_stride Number of columns to grow to if the frame is wider than stride
+   */
+  inline void reset(T_Cloud& cloud, const size_t& height, const size_t& stride, const size_t& max_stride)
+  {
+    cloud_ = &cloud;
+    height_ = height;
+    stride_ = stride;
+    max_stride_ = max_stride;
+    point_num_ = 0;
+    tile_col_ = 0;
+    tile_.clear();
+    cloud_->resize(height_ * stride_);
+  }
+
+  /**
+   * @brief Copy the last tile into the rows, close up the rows to the real width of the frame and return the width
+   */
+  inline size_t finish()
+  {
+    flushTile();
+    size_t width = (point_num_ + height_ - 1) / height_;
+    moveRows(*cloud_, height_, stride_, width, width);
+    cloud_->resize(height_ * width);
+    stride_ = width;
+    return width;
+  }
+
+  inline size_t size() const  ///< Number of points decoded into the frame so far
+  {
+    return point_num_;
+  }
+
+  inline void resize(const size_t& point_num)  ///< The decoders resize the cloud before writing a block of points
+  {
+    if (point_num_ >= (tile_col_ + TILE_COLS) * height_)
+    {
+      flushTile();
+    }
+    point_num_ = point_num;
+    size_t width = (point_num_ + height_ - 1) / height_;
+    if (width > stride_)
+    {
+      size_t new_stride = std::max(width, max_stride_);
+      cloud_->resize(height_ * new_stride);
+      moveRows(*cloud_, height_, stride_, new_stride, stride_);
+      stride_ = new_stride;
+    }
+    tile_.resize(point_num_ - tile_col_ * height_);
+  }
+
+  inline T_Cloud& cloud()
+  {
+    return *cloud_;
+  }
+
+  inline T_Cloud& tile()
+  {
+    return tile_;
+  }
+
+  inline const T_Cloud& tile() const
+  {
+    return tile_;
+  }
+
+  inline size_t index(const size_t& idx) const  ///< Position in the tile of the idx-th point in column-major order
+  {
+    return idx - tile_col_ * height_;
+  }
+
+private:
+  inline void flushTile()
+  {
+    copyTileToRows(tile_, height_, tile_.size(), *cloud_, stride_, tile_col_);
+    tile_col_ = point_num_ / height_;
+    tile_.clear();
+  }
+
+  T_Cloud* cloud_;
+  T_Cloud tile_;  ///< Columns from tile_col_ on, column-major
+  size_t height_;
+  size_t stride_;
+  size_t max_stride_;
+  size_t point_num_;
+  size_t tile_col_;
+};
+
+}  // namespace lidar
+}  // namespace robosense
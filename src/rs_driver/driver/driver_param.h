@@ -55,6 +55,12 @@ enum SplitFrameMode
   SPLIT_BY_CUSTOM_PKTS
 };
 
+enum PcapReplayMode
+{
+  PCAP_REPLAY_BY_TIMESTAMP = 1,  ///< Pace packets by their capture timestamps, scaled by pcap_rate
+  PCAP_REPLAY_MAX_THROUGHPUT     ///< Read packets without sleeping. Wait for the decoder instead of dropping packets
+};
+
 typedef struct RSCameraTriggerParam  ///< Camera trigger parameters
 {
   std::map<double, std::string> trigger_map;  ///< Map stored the trigger angle and camera frame id
@@ -103,7 +109,8 @@ typedef struct RSDecoderParam  ///< LiDAR decoder parameter
                                                                      ///< 3: Split frames by custom number of packets (num_pkts_split)
   uint32_t num_pkts_split = 1;         ///< Number of packets in one frame, only be used when split_frame_mode=3
   float cut_angle = 0.0f;              ///< Cut angle(degree) used to split frame, only be used when split_frame_mode=1
-  bool use_lidar_clock = false;        ///< true: use LiDAR clock as timestamp; false: use system clock as timestamp
+  bool use_lidar_clock = false;        ///< true: use LiDAR clock as timestamp; false: use the packet receive time
+  bool use_simd = true;                ///< false: decode with the scalar kernel even if the CPU supports AVX2
   RSTransformParam transform_param;    ///< Used to transform points
   RSCameraTriggerParam trigger_param;  ///< Used to trigger camera
   void print() const                  
@@ -117,6 +124,7 @@ typedef struct RSDecoderParam  ///< LiDAR decoder parameter
     RS_INFOL << "start_angle: " << start_angle << RS_REND;
     RS_INFOL << "end_angle: " << end_angle << RS_REND;
     RS_INFOL << "use_lidar_clock: " << use_lidar_clock << RS_REND;
+    RS_INFOL << "use_simd: " << use_simd << RS_REND;
     RS_INFOL << "split_frame_mode: " << split_frame_mode << RS_REND;
     RS_INFOL << "num_pkts_split: " << num_pkts_split << RS_REND;
     RS_INFOL << "cut_angle: " << cut_angle << RS_REND;
@@ -133,8 +141,23 @@ typedef struct RSInputParam  ///< The LiDAR input parameter
   bool read_pcap = false;          ///< true: The driver will process the pcap through pcap_path. false: The driver will
                                    ///< Get data from online LiDAR
   double pcap_rate = 1;            ///< Rate to read the pcap file
+  PcapReplayMode pcap_replay_mode = PcapReplayMode::PCAP_REPLAY_BY_TIMESTAMP;  ///< 1: Replay at the capture rate;
+                                                                               ///< 2: Replay as fast as decoding allows
   bool pcap_repeat = true;         ///< true: The pcap bag will repeat play
   std::string pcap_path = "null";  ///< Absolute path of pcap file
+  uint32_t recv_batch_size = 1;    ///< Number of msop packets received per system call. Values larger than 1 enable
+                                   ///< the batched receive mode (recvmmsg, Linux only)
+  bool use_hw_timestamp = false;   ///< true: Stamp the packets with the receive time of the NIC instead of the
+                                   ///< kernel (SO_TIMESTAMPING, Linux only). Hardware timestamping must be enabled
+                                   ///< on the NIC, and its clock synchronized to the system clock (e.g. phc2sys)
+  bool share_port = false;         ///< true: Other LiDARs send to the same ports. The packets are told apart by
+                                   ///< device_ip, the source address (Linux only, IPv4)
+  uint32_t msop_socket_num = 1;    ///< Number of SO_REUSEPORT sockets on the msop port, each read by its own thread.
+                                   ///< The packets are spread over them by source address (Linux only)
+  std::vector<int32_t> msop_thread_cpus;  ///< CPU core each msop receive thread is bound to. Missing or -1 means no
+                                          ///< binding (Linux only)
+  uint32_t msop_recv_buffer_size = 0;  ///< Kernel receive buffer of the msop sockets, in bytes. 0 keeps the system
+                                       ///< default. Above net.core.rmem_max, it needs CAP_NET_ADMIN (SO_RCVBUFFORCE)
   void print() const             
   {
     RS_INFO << "------------------------------------------------------" << RS_REND;
@@ -143,31 +166,98 @@ typedef struct RSInputParam  ///< The LiDAR input parameter
     RS_INFOL << "msop_port: " << msop_port << RS_REND;
     RS_INFOL << "difop_port: " << difop_port << RS_REND;
     RS_INFOL << "read_pcap: " << read_pcap << RS_REND;
+    RS_INFOL << "pcap_rate: " << pcap_rate << RS_REND;
+    RS_INFOL << "pcap_replay_mode: " << pcap_replay_mode << RS_REND;
     RS_INFOL << "pcap_repeat: " << pcap_repeat << RS_REND;
     RS_INFOL << "pcap_path: " << pcap_path << RS_REND;
+    RS_INFOL << "recv_batch_size: " << recv_batch_size << RS_REND;
+    RS_INFOL << "use_hw_timestamp: " << use_hw_timestamp << RS_REND;
+    RS_INFOL << "share_port: " << share_port << RS_REND;
+    RS_INFOL << "msop_socket_num: " << msop_socket_num << RS_REND;
+    RS_INFOL << "msop_thread_cpus:";
+    for (const auto& cpu : msop_thread_cpus)
+    {
+      RS_INFO << " " << cpu;
+    }
+    RS_INFO << RS_REND;
+    RS_INFOL << "msop_recv_buffer_size: " << msop_recv_buffer_size << RS_REND;
     RS_INFO << "------------------------------------------------------" << RS_REND;
   }
 } RSInputParam;
 
+typedef struct RSRecorderParam  ///< Parameters of the recorder of the received packets
+{
+  std::string record_path = "";   ///< Pcap file the packets are recorded to. Empty disables the recorder
+  uint32_t max_file_size = 0;      ///< Start a new file after this size(MB), 0 means no limit
+  uint32_t max_file_duration = 0;  ///< Start a new file after this time(s), 0 means no limit. With either limit,
+                                   ///< the files are numbered, e.g. record_0000.pcap
+  bool use_direct_io = false;      ///< true: write with O_DIRECT, bypassing the page cache (Linux only)
+  uint32_t buffer_size = 16;       ///< Size(MB) of each of the two record buffers. Packets are dropped when both
+                                   ///< are full
+  void print() const
+  {
+    RS_INFO << "------------------------------------------------------" << RS_REND;
+    RS_INFO << "             RoboSense Recorder Parameters " << RS_REND;
+    RS_INFOL << "record_path: " << record_path << RS_REND;
+    RS_INFOL << "max_file_size: " << max_file_size << RS_REND;
+    RS_INFOL << "max_file_duration: " << max_file_duration << RS_REND;
+    RS_INFOL << "use_direct_io: " << use_direct_io << RS_REND;
+    RS_INFOL << "buffer_size: " << buffer_size << RS_REND;
+    RS_INFO << "------------------------------------------------------" << RS_REND;
+  }
+} RSRecorderParam;
+
+typedef struct RSDriverStatistics  ///< Packet counters of a driver, see LidarDriver::getStatistics()
+{
+  uint64_t msop_pkts = 0;           ///< Msop packets received
+  uint64_t difop_pkts = 0;          ///< Difop packets received
+  uint64_t msop_kernel_drops = 0;   ///< Msop packets dropped by the kernel, e.g. because the receive buffer was full.
+                                    ///< Linux only, and not counted with share_port or with multicast to several
+                                    ///< msop sockets, whose socket filters drop packets too
+  uint64_t difop_kernel_drops = 0;  ///< Difop packets dropped by the kernel, as msop_kernel_drops
+  uint64_t msop_queue_drops = 0;    ///< Msop packets dropped because the decoder fell behind (ERRCODE_PKTBUFOVERFLOW)
+  void print() const
+  {
+    RS_INFO << "------------------------------------------------------" << RS_REND;
+    RS_INFO << "             RoboSense Driver Statistics " << RS_REND;
+    RS_INFOL << "msop_pkts: " << msop_pkts << RS_REND;
+    RS_INFOL << "difop_pkts: " << difop_pkts << RS_REND;
+    RS_INFOL << "msop_kernel_drops: " << msop_kernel_drops << RS_REND;
+    RS_INFOL << "difop_kernel_drops: " << difop_kernel_drops << RS_REND;
+    RS_INFOL << "msop_queue_drops: " << msop_queue_drops << RS_REND;
+    RS_INFO << "------------------------------------------------------" << RS_REND;
+  }
+} RSDriverStatistics;
+
 typedef struct RSDriverParam  ///< The LiDAR driver parameter
 {
   RSInputParam input_param;                ///< Input parameter
   RSDecoderParam decoder_param;            ///< Decoder parameter
+  RSRecorderParam recorder_param;          ///< Recorder parameter
   std::string angle_path = "null";         ///< Path of angle calibration files(angle.csv).Only used for internal debugging.
   std::string frame_id = "rslidar";        ///< The frame id of LiDAR message
   LidarType lidar_type = LidarType::RS16;  ///< Lidar type
   bool wait_for_difop = true;              ///< true: start sending point cloud until receive difop packet
   bool saved_by_rows = false;  ///< true: the output point cloud will be saved by rows (default is saved by columns)
+  bool use_decode_thread = false;  ///< true: decode msop packets in a dedicated thread owned by the driver instead of
+                                  ///< tasks of the shared thread pool
+  int32_t decode_thread_cpu = -1;  ///< CPU core the decode thread is bound to. -1 means no binding (Linux only)
+  int32_t decode_thread_priority = 0;  ///< SCHED_FIFO priority(1~99) of the decode thread. 0 keeps the default
+                                       ///< scheduling policy (Linux only)
   void print() const           
   {
     input_param.print();
     decoder_param.print();
+    recorder_param.print();
     RS_INFO << "------------------------------------------------------" << RS_REND;
     RS_INFOL << "             RoboSense Driver Parameters " << RS_REND;
     RS_INFOL << "angle_path: " << angle_path << RS_REND;
     RS_INFOL << "frame_id: " << frame_id << RS_REND;
     RS_INFOL << "lidar_type: ";
     RS_INFO << lidarTypeToStr(lidar_type) << RS_REND;
+    RS_INFOL << "use_decode_thread: " << use_decode_thread << RS_REND;
+    RS_INFOL << "decode_thread_cpu: " << decode_thread_cpu << RS_REND;
+    RS_INFOL << "decode_thread_priority: " << decode_thread_priority << RS_REND;
     RS_INFOL << "------------------------------------------------------" << RS_REND;
   }
   static std::string lidarTypeToStr(const LidarType& type)
@@ -34,16 +34,15 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rs_driver/common/common_header.h>
 #include <rs_driver/common/error_code.h>
 #include <rs_driver/utility/thread_pool.hpp>
+#include <rs_driver/utility/time.h>
 #include <rs_driver/driver/driver_param.h>
+#include <rs_driver/driver/input_reactor.hpp>
+#include <rs_driver/driver/port_demux.hpp>
+#include <rs_driver/driver/recv_batch.hpp>
+#include <rs_driver/driver/pcap_index.hpp>
+#include <rs_driver/driver/udp_parser.hpp>
 #include <rs_driver/msg/packet_msg.h>
-///< 1.0 second / 10 Hz / (360 degree / horiz angle resolution / column per msop packet) * (s to us)
-constexpr double RS16_PCAP_SLEEP_DURATION = 1200;  ///< us
-constexpr double RS32_PCAP_SLEEP_DURATION = 530;          ///< us
-constexpr double RSBP_PCAP_SLEEP_DURATION = 530;          ///< us
-constexpr double RS128_PCAP_SLEEP_DURATION = 100;          ///< us
-constexpr double RS80_PCAP_SLEEP_DURATION = 135;           ///< us
-constexpr double RSM1_PCAP_SLEEP_DURATION = 90;                ///< us
-constexpr double RSHELIOS_PCAP_SLEEP_DURATION = 530;      ///< us
+constexpr double PCAP_MAX_REPLAY_GAP = 1.0;  ///< s, longer gaps between captured packets are not replayed
 using boost::asio::deadline_timer;
 using boost::asio::ip::address;
 using boost::asio::ip::udp;
@@ -62,12 +61,33 @@ public:
   void stop();
   void regRecvMsopCallback(const std::function<void(const PacketMsg&)>& callback);
   void regRecvDifopCallback(const std::function<void(const PacketMsg&)>& callback);
+  void regRecvMsopBatchCallback(const std::function<void(const std::vector<PacketMsg>&)>& callback);
+  inline bool seekPcap(const PcapIndexEntry& entry);
+  inline bool scanPcap(const std::function<void(const uint8_t*, const bool&, const PcapPosition&)>& callback);
+  inline std::string getPcapKey();
+  inline void getStatistics(RSDriverStatistics& stats);  ///< Fill in the kernel drops
+#ifdef __linux__
+  inline void setReactor(const InputReactor::Ptr& reactor);  ///< Read the sockets on the loops of reactor instead of
+                                                             ///< own threads. Call it before start()
+#endif
 
 private:
   inline bool setSocket(const std::string& pkt_type);
   inline void getMsopPacket();
+#ifdef __linux__
+  inline void getMsopPacketBatch();
+  inline bool setMsopFanoutSockets();
+  inline bool setFanoutFilter(const int& fd, const size_t& idx);
+  inline void getMsopPacketFanout(const size_t& idx);
+  inline int recvMsopBatch(const int& fd, RecvBatch& rb);
+  inline void recvDifopPacket();
+  inline void dispatchMsop(std::vector<PacketMsg>& pkts);
+  inline void dispatchDifop(std::vector<PacketMsg>& pkts);
+#endif
   inline void getDifopPacket();
   inline void getPcapPacket();
+  inline bool parsePcapPacket(const PcapPacket& pcap_pkt, UdpParser& parser, UdpDatagram& udp, bool& is_msop) const;
+  inline void sendPcapPacket(const UdpDatagram& udp, const bool& is_msop);
   inline void checkDifopDeadline();
   inline void checkMsopDeadline();
   static void handleReceive(const boost::system::error_code& ec, std::size_t length, boost::system::error_code* out_ec,
@@ -80,11 +100,11 @@ private:
   bool init_flag_;
   uint32_t msop_pkt_length_;
   uint32_t difop_pkt_length_;
+  uint32_t device_addr_;  ///< device_ip, host byte order
+  PacketPool::Ptr pkt_pool_;
   /* pcap file parse */
-  pcap_t* pcap_;
-  bpf_program pcap_msop_filter_;
-  bpf_program pcap_difop_filter_;
-  std::chrono::time_point<std::chrono::system_clock, std::chrono::system_clock::duration> last_packet_time_;
+  PcapReader pcap_reader_;
+  UdpParser udp_parser_;
   /* live socket */
   std::unique_ptr<udp::socket> msop_sock_ptr_;
   std::unique_ptr<udp::socket> difop_sock_ptr_;
@@ -97,13 +117,31 @@ private:
   boost::asio::io_service difop_io_service_;
   std::vector<std::function<void(const PacketMsg&)>> difop_cb_;
   std::vector<std::function<void(const PacketMsg&)>> msop_cb_;
+  std::vector<std::function<void(const std::vector<PacketMsg>&)>> msop_batch_cb_;
+#ifdef __linux__
+  RecvBatch msop_recv_batch_;
+  DropCounter msop_drops_;   ///< Of msop_sock_ptr_, when read one packet at a time
+  DropCounter difop_drops_;  ///< Of difop_sock_ptr_
+  InputReactor::Ptr reactor_;
+  PortDemux::Ptr msop_demux_;   ///< Shared msop socket, if share_port
+  PortDemux::Ptr difop_demux_;  ///< Shared difop socket, if share_port
+  bool routed_ = false;         ///< The demuxes route device_ip to this input
+  struct MsopWorker             ///< One of the SO_REUSEPORT sockets of the msop port, with its receive thread
+  {
+    std::unique_ptr<udp::socket> sock;
+    RecvBatch recv_batch;
+    std::thread thread;
+  };
+  std::vector<std::unique_ptr<MsopWorker>> msop_workers_;
+  std::mutex msop_dispatch_mutex_;          ///< Serializes the calls of the msop callbacks
+  std::atomic<uint64_t> msop_batch_num_{0};  ///< Batches received by the workers, for the msop timeout
+#endif
 };
 
 inline Input::Input(const LidarType& type, const RSInputParam& input_param,
                     const std::function<void(const Error&)>& excb)
-  : lidar_type_(type), input_param_(input_param), excb_(excb), init_flag_(false), pcap_(nullptr)
+  : lidar_type_(type), input_param_(input_param), excb_(excb), init_flag_(false)
 {
-  last_packet_time_ = std::chrono::system_clock::now();
   input_param_.pcap_rate = input_param_.pcap_rate < 0.1 ? 0.1 : input_param_.pcap_rate;
   switch (type)
   {
@@ -116,15 +154,14 @@ inline Input::Input(const LidarType& type, const RSInputParam& input_param,
       difop_pkt_length_ = MECH_PKT_LEN;
       break;
   }
+  pkt_pool_ = std::make_shared<PacketPool>(std::max(msop_pkt_length_, difop_pkt_length_));
+  boost::system::error_code ec;
+  device_addr_ = boost::asio::ip::address_v4::from_string(input_param_.device_ip, ec).to_ulong();
 }
 
 inline Input::~Input()
 {
   stop();
-  if (pcap_ != NULL)
-  {
-    pcap_close(pcap_);
-  }
   msop_sock_ptr_.reset();
   difop_sock_ptr_.reset();
   msop_deadline_.reset();
@@ -135,24 +172,11 @@ inline bool Input::init()
 {
   if (input_param_.read_pcap)
   {
-    char errbuf[PCAP_ERRBUF_SIZE];
-    if ((pcap_ = pcap_open_offline(input_param_.pcap_path.c_str(), errbuf)) == NULL)
+    if (!pcap_reader_.open(input_param_.pcap_path))
     {
       excb_(Error(ERRCODE_PCAPWRONGPATH));
       return false;
     }
-    else
-    {
-      std::stringstream msop_filter;
-      std::stringstream difop_filter;
-      /*ip address filter*/
-      // msop_filter << "src host " << input_param_.device_ip << " && ";
-      // difop_filter << "src host " << input_param_.device_ip << " && ";
-      msop_filter << "udp dst port " << input_param_.msop_port;
-      difop_filter << "udp dst port " << input_param_.difop_port;
-      pcap_compile(pcap_, &pcap_msop_filter_, msop_filter.str().c_str(), 1, 0xFFFFFFFF);
-      pcap_compile(pcap_, &pcap_difop_filter_, difop_filter.str().c_str(), 1, 0xFFFFFFFF);
-    }
   }
   else
   {
@@ -172,11 +196,70 @@ inline bool Input::start()
     excb_(Error(ERRCODE_STARTBEFOREINIT));
     return false;
   }
+#ifdef __linux__
+  if (!input_param_.read_pcap && input_param_.share_port)
+  {
+    if (routed_)
+    {
+      return true;
+    }
+    if (!msop_demux_->addRoute(device_addr_, [this](std::vector<PacketMsg>& pkts) { dispatchMsop(pkts); }, 1.0,
+                               [this]() { excb_(Error(ERRCODE_MSOPTIMEOUT)); }))
+    {
+      RS_ERROR << "Another LiDAR with the ip " << input_param_.device_ip << " shares the ports" << RS_REND;
+      return false;
+    }
+    if (!difop_demux_->addRoute(device_addr_, [this](std::vector<PacketMsg>& pkts) { dispatchDifop(pkts); }, 2.0,
+                                [this]() { excb_(Error(ERRCODE_DIFOPTIMEOUT)); }))
+    {
+      RS_ERROR << "Another LiDAR with the ip " << input_param_.device_ip << " shares the ports" << RS_REND;
+      msop_demux_->removeRoute(device_addr_);
+      return false;
+    }
+    routed_ = true;
+    return true;
+  }
+  if (!input_param_.read_pcap && reactor_ != nullptr && msop_workers_.empty())
+  {
+    msop_recv_batch_.init(std::max<uint32_t>(input_param_.recv_batch_size, 1), msop_pkt_length_);
+    int msop_fd = msop_sock_ptr_->native_handle();
+    if (!reactor_->add(msop_fd, [this, msop_fd]() { recvMsopBatch(msop_fd, msop_recv_batch_); }, 1.0,
+                       [this]() { excb_(Error(ERRCODE_MSOPTIMEOUT)); }) ||
+        !reactor_->add(difop_sock_ptr_->native_handle(), [this]() { recvDifopPacket(); }, 2.0,
+                       [this]() { excb_(Error(ERRCODE_DIFOPTIMEOUT)); }))
+    {
+      stop();
+      return false;
+    }
+    return true;
+  }
+#endif
   if (!input_param_.read_pcap)
   {
     msop_thread_.start_.store(true);
     difop_thread_.start_.store(true);
-    msop_thread_.thread_.reset(new std::thread([this]() { getMsopPacket(); }));
+#ifdef __linux__
+    if (!msop_workers_.empty())
+    {
+      for (size_t i = 0; i < msop_workers_.size(); i++)
+      {
+        msop_workers_[i]->thread = std::thread([this, i]() { getMsopPacketFanout(i); });
+        const std::vector<int32_t>& cpus = input_param_.msop_thread_cpus;
+        if (i < cpus.size() && cpus[i] >= 0 && !setThreadAffinity(msop_workers_[i]->thread, cpus[i]))
+        {
+          RS_WARNING << "Failed to bind msop receive thread " << i << " to cpu " << cpus[i] << RS_REND;
+        }
+      }
+    }
+    else if (input_param_.recv_batch_size > 1)
+    {
+      msop_thread_.thread_.reset(new std::thread([this]() { getMsopPacketBatch(); }));
+    }
+    else
+#endif
+    {
+      msop_thread_.thread_.reset(new std::thread([this]() { getMsopPacket(); }));
+    }
     difop_thread_.thread_.reset(new std::thread([this]() { getDifopPacket(); }));
   }
   else
@@ -189,6 +272,27 @@ inline bool Input::start()
 
 inline void Input::stop()
 {
+#ifdef __linux__
+  if (!input_param_.read_pcap && input_param_.share_port)
+  {
+    if (routed_)
+    {
+      msop_demux_->removeRoute(device_addr_);
+      difop_demux_->removeRoute(device_addr_);
+      routed_ = false;
+    }
+    return;
+  }
+  if (!input_param_.read_pcap && reactor_ != nullptr && msop_workers_.empty())
+  {
+    if (msop_sock_ptr_ != nullptr)
+    {
+      reactor_->remove(msop_sock_ptr_->native_handle());
+      reactor_->remove(difop_sock_ptr_->native_handle());
+    }
+    return;
+  }
+#endif
   if (!input_param_.read_pcap)
   {
     msop_thread_.start_.store(false);
@@ -201,6 +305,15 @@ inline void Input::stop()
     {
       difop_thread_.thread_->join();
     }
+#ifdef __linux__
+    for (auto& worker : msop_workers_)
+    {
+      if (worker->thread.joinable())
+      {
+        worker->thread.join();
+      }
+    }
+#endif
   }
   else
   {
@@ -222,8 +335,53 @@ inline void Input::regRecvDifopCallback(const std::function<void(const PacketMsg
   difop_cb_.emplace_back(callback);
 }
 
+#ifdef __linux__
+inline void Input::setReactor(const InputReactor::Ptr& reactor)
+{
+  reactor_ = reactor;
+}
+#endif
+
+inline void Input::getStatistics(RSDriverStatistics& stats)
+{
+#ifdef __linux__
+  stats.msop_kernel_drops = msop_drops_.total.load() + msop_recv_batch_.drops.total.load();
+  for (const auto& worker : msop_workers_)
+  {
+    stats.msop_kernel_drops += worker->recv_batch.drops.total.load();
+  }
+  stats.difop_kernel_drops = difop_drops_.total.load();
+#endif
+}
+
+/* Used by the batched receive mode and with a reactor. Without batch callbacks the packets are delivered one by one */
+inline void Input::regRecvMsopBatchCallback(const std::function<void(const std::vector<PacketMsg>&)>& callback)
+{
+  msop_batch_cb_.emplace_back(callback);
+}
+
 inline bool Input::setSocket(const std::string& pkt_type)
 {
+#ifdef __linux__
+  if (input_param_.share_port)
+  {
+    bool is_msop = (pkt_type == "msop");
+    PortDemux::Ptr demux = PortDemux::open(is_msop ? input_param_.msop_port : input_param_.difop_port,
+                                           input_param_.multi_cast_address, input_param_.use_hw_timestamp,
+                                           is_msop ? input_param_.msop_recv_buffer_size : 0);
+    if (demux == nullptr)
+    {
+      excb_(Error(is_msop ? ERRCODE_MSOPPORTBUZY : ERRCODE_DIFOPPORTBUZY));
+      return false;
+    }
+    (is_msop ? msop_demux_ : difop_demux_) = demux;
+    return true;
+  }
+  if (pkt_type == "msop" && input_param_.msop_socket_num > 1 && reactor_ == nullptr)
+  {
+    return setMsopFanoutSockets();
+  }
+#endif
   if (pkt_type == "msop")
   {
     try
@@ -242,6 +400,20 @@ inline bool Input::setSocket(const std::string& pkt_type)
           boost::asio::ip::multicast::join_group(address::from_string(input_param_.multi_cast_address).to_v4(),
                                                  udp::endpoint(udp::v4(), input_param_.msop_port).address().to_v4()));
     }
+#ifdef __linux__
+    enableRecvTimestamp(msop_sock_ptr_->native_handle(), input_param_.use_hw_timestamp);
+    enableRecvDropCount(msop_sock_ptr_->native_handle());
+    if (input_param_.msop_recv_buffer_size > 0)
+    {
+      setRecvBufferSize(msop_sock_ptr_->native_handle(), input_param_.msop_recv_buffer_size);
+    }
+#else
+    if (input_param_.msop_recv_buffer_size > 0)
+    {
+      boost::system::error_code ec;
+      msop_sock_ptr_->set_option(boost::asio::socket_base::receive_buffer_size(input_param_.msop_recv_buffer_size), ec);
+    }
+#endif
     msop_deadline_->expires_at(boost::posix_time::pos_infin);
     checkMsopDeadline();
   }
@@ -263,6 +435,10 @@ inline bool Input::setSocket(const std::string& pkt_type)
           boost::asio::ip::multicast::join_group(address::from_string(input_param_.multi_cast_address).to_v4(),
                                                  udp::endpoint(udp::v4(), input_param_.difop_port).address().to_v4()));
     }
+#ifdef __linux__
+    enableRecvTimestamp(difop_sock_ptr_->native_handle(), input_param_.use_hw_timestamp);
+    enableRecvDropCount(difop_sock_ptr_->native_handle());
+#endif
     difop_deadline_->expires_at(boost::posix_time::pos_infin);
     checkDifopDeadline();
   }
@@ -271,15 +447,25 @@ inline bool Input::setSocket(const std::string& pkt_type)
 
 inline void Input::getMsopPacket()
 {
-  char* precv_buffer = (char*)malloc(msop_pkt_length_);
+  PacketBuffer buffer;
   while (msop_thread_.start_.load())
   {
+    if (buffer.data() == nullptr)
+    {
+      buffer = pkt_pool_->allocate();
+    }
     msop_deadline_->expires_from_now(boost::posix_time::seconds(1));
     boost::system::error_code ec = boost::asio::error::would_block;
     std::size_t ret = 0;
 
-    msop_sock_ptr_->async_receive(boost::asio::buffer(precv_buffer, msop_pkt_length_),
+#ifdef __linux__
+    /* Wait until the socket is readable, then read the packet with its receive time */
+    msop_sock_ptr_->async_receive(boost::asio::null_buffers(),
+                                  boost::bind(&Input::handleReceive, _1, _2, &ec, &ret));
+#else
+    msop_sock_ptr_->async_receive(boost::asio::buffer(buffer.data(), msop_pkt_length_),
                                   boost::bind(&Input::handleReceive, _1, _2, &ec, &ret));
+#endif
     do
     {
       msop_io_service_.run_one();
@@ -289,32 +475,293 @@ inline void Input::getMsopPacket()
       excb_(Error(ERRCODE_MSOPTIMEOUT));
       continue;
     }
+#ifdef __linux__
+    ssize_t len = recvPacket(msop_sock_ptr_->native_handle(), buffer, msop_pkt_length_, msop_drops_);
+    if (len < 0)
+    {
+      continue;
+    }
+    ret = static_cast<std::size_t>(len);
+#else
+    buffer.setTimestamp(getTime());
+#endif
     if (ret < msop_pkt_length_)
     {
       excb_(Error(ERRCODE_MSOPINCOMPLETE));
       continue;
     }
-    PacketMsg msg(msop_pkt_length_);
-    memcpy(msg.packet.data(), precv_buffer, msop_pkt_length_);
+    buffer.resize(msop_pkt_length_);
+    PacketMsg msg(std::move(buffer));
     for (auto& iter : msop_cb_)
     {
       iter(msg);
     }
   }
-  free(precv_buffer);
 }
 
+#ifdef __linux__
+inline void Input::getMsopPacketBatch()
+{
+  msop_recv_batch_.init(input_param_.recv_batch_size, msop_pkt_length_);
+  struct pollfd pfd;
+  pfd.fd = msop_sock_ptr_->native_handle();
+  pfd.events = POLLIN;
+  while (msop_thread_.start_.load())
+  {
+    int ret = poll(&pfd, 1, 1000);
+    if (ret == 0)
+    {
+      excb_(Error(ERRCODE_MSOPTIMEOUT));
+      continue;
+    }
+    else if (ret < 0)
+    {
+      continue;
+    }
+    recvMsopBatch(pfd.fd, msop_recv_batch_);
+  }
+}
+
+/* Open msop_socket_num sockets on the msop port with SO_REUSEPORT, one per receive thread */
+inline bool Input::setMsopFanoutSockets()
+{
+  for (size_t i = 0; i < input_param_.msop_socket_num; i++)
+  {
+    std::unique_ptr<MsopWorker> worker(new MsopWorker);
+    try
+    {
+      worker->sock.reset(new udp::socket(msop_io_service_, udp::v4()));
+      int fd = worker->sock->native_handle();
+      int on = 1;
+      if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0 || !setFanoutFilter(fd, i))
+      {
+        throw std::runtime_error("fanout");
+      }
+      worker->sock->bind(udp::endpoint(udp::v4(), input_param_.msop_port));
+    }
+    catch (...)
+    {
+      msop_workers_.clear();
+      excb_(Error(ERRCODE_MSOPPORTBUZY));
+      return false;
+    }
+    if (input_param_.multi_cast_address != "0.0.0.0")
+    {
+      worker->sock->set_option(
+          boost::asio::ip::multicast::join_group(address::from_string(input_param_.multi_cast_address).to_v4(),
+                                                 udp::endpoint(udp::v4(), input_param_.msop_port).address().to_v4()));
+    }
+    enableRecvTimestamp(worker->sock->native_handle(), input_param_.use_hw_timestamp);
+    if (input_param_.multi_cast_address == "0.0.0.0")  ///< Multicast sockets drop the packets of the others
+    {
+      enableRecvDropCount(worker->sock->native_handle());
+    }
+    if (input_param_.msop_recv_buffer_size > 0)
+    {
+      setRecvBufferSize(worker->sock->native_handle(), input_param_.msop_recv_buffer_size);
+    }
+    worker->recv_batch.init(std::max<uint32_t>(input_param_.recv_batch_size, 1), msop_pkt_length_);
+    msop_workers_.emplace_back(std::move(worker));
+  }
+  return true;
+}
+
+/* Steer the packets of each source to socket (source address % msop_socket_num), so that the packets of one LiDAR
+ * stay in order on one thread. The kernel picks one socket of the group for unicast, with the program attached to
+ * the first socket. Multicast is copied to all sockets instead, and each socket drops the packets of the others:
+ *   unicast:   ld [ip src]; mod n; ret a
+ *   multicast: ld [ip src]; mod n; jeq idx, accept; ret 0; accept: ret -1 */
+inline bool Input::setFanoutFilter(const int& fd, const size_t& idx)
+{
+  std::vector<struct sock_filter> code;
+  code.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<uint32_t>(SKF_NET_OFF + 12)));
+  code.push_back(BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, input_param_.msop_socket_num));
+  int opt;
+  if (input_param_.multi_cast_address == "0.0.0.0")
+  {
+    if (idx != 0)
+    {
+      return true;
+    }
+    code.push_back(BPF_STMT(BPF_RET | BPF_A, 0));
+    opt = SO_ATTACH_REUSEPORT_CBPF;
+  }
+  else
+  {
+    code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<uint32_t>(idx), 1, 0));
+    code.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+    code.push_back(BPF_STMT(BPF_RET | BPF_K, 0xFFFFFFFF));
+    opt = SO_ATTACH_FILTER;
+  }
+  struct sock_fprog prog;
+  prog.len = static_cast<unsigned short>(code.size());
+  prog.filter = code.data();
+  if (setsockopt(fd, SOL_SOCKET, opt, &prog, sizeof(prog)) != 0)
+  {
+    if (opt == SO_ATTACH_FILTER)
+    {
+      return false;
+    }
+    RS_WARNING << "Failed to steer the msop packets by source, the kernel spreads them by flow hash" << RS_REND;
+  }
+  return true;
+}
+
+/* Receive thread of msop socket idx. Thread 0 also reports the timeout, when no worker got packets for 1s */
+inline void Input::getMsopPacketFanout(const size_t& idx)
+{
+  MsopWorker& worker = *msop_workers_[idx];
+  struct pollfd pfd;
+  pfd.fd = worker.sock->native_handle();
+  pfd.events = POLLIN;
+  uint64_t last_batch_num = msop_batch_num_.load();
+  while (msop_thread_.start_.load())
+  {
+    int ret = poll(&pfd, 1, 1000);
+    if (ret == 0)
+    {
+      uint64_t batch_num = msop_batch_num_.load();
+      if (idx == 0 && batch_num == last_batch_num)
+      {
+        excb_(Error(ERRCODE_MSOPTIMEOUT));
+      }
+      last_batch_num = batch_num;
+      continue;
+    }
+    else if (ret < 0)
+    {
+      continue;
+    }
+    if (recvMsopBatch(pfd.fd, worker.recv_batch) > 0)
+    {
+      msop_batch_num_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+/* Read the waiting msop packets of fd, up to one batch, and pass them on. Returns the number of packets read */
+inline int Input::recvMsopBatch(const int& fd, RecvBatch& rb)
+{
+  int npkts = rb.recv(fd, *pkt_pool_);
+  if (npkts <= 0)
+  {
+    return npkts;
+  }
+  rb.batch.clear();
+  for (int i = 0; i < npkts; i++)
+  {
+    rb.buffers[i].resize(rb.msgs[i].msg_len);
+    rb.batch.emplace_back(std::move(rb.buffers[i]));
+  }
+  std::lock_guard<std::mutex> lock(msop_dispatch_mutex_);  ///< The driver queues msop packets from one thread
+  dispatchMsop(rb.batch);
+  return npkts;
+}
+
+/* Read one waiting difop packet, if any, and pass it on */
+inline void Input::recvDifopPacket()
+{
+  PacketBuffer buffer = pkt_pool_->allocate();
+  ssize_t len = recvPacket(difop_sock_ptr_->native_handle(), buffer, difop_pkt_length_, difop_drops_);
+  if (len < 0)
+  {
+    return;
+  }
+  if (static_cast<size_t>(len) < difop_pkt_length_)
+  {
+    excb_(Error(ERRCODE_DIFOPINCOMPLETE));
+    return;
+  }
+  buffer.resize(difop_pkt_length_);
+  PacketMsg msg(std::move(buffer));
+  for (auto& iter : difop_cb_)
+  {
+    iter(msg);
+  }
+}
+
+/* Pass received msop packets on, without the incomplete ones */
+inline void Input::dispatchMsop(std::vector<PacketMsg>& pkts)
+{
+  size_t num = 0;
+  for (size_t i = 0; i < pkts.size(); i++)
+  {
+    if (pkts[i].packet.size() < msop_pkt_length_)
+    {
+      excb_(Error(ERRCODE_MSOPINCOMPLETE));
+      continue;
+    }
+    pkts[i].packet.resize(msop_pkt_length_);
+    if (num != i)
+    {
+      pkts[num] = std::move(pkts[i]);
+    }
+    num++;
+  }
+  pkts.resize(num);
+  if (pkts.empty())
+  {
+    return;
+  }
+  if (!msop_batch_cb_.empty())
+  {
+    for (auto& iter : msop_batch_cb_)
+    {
+      iter(pkts);
+    }
+  }
+  else
+  {
+    for (const auto& msg : pkts)
+    {
+      for (auto& iter : msop_cb_)
+      {
+        iter(msg);
+      }
+    }
+  }
+}
+
+inline void Input::dispatchDifop(std::vector<PacketMsg>& pkts)
+{
+  for (auto& msg : pkts)
+  {
+    if (msg.packet.size() < difop_pkt_length_)
+    {
+      excb_(Error(ERRCODE_DIFOPINCOMPLETE));
+      continue;
+    }
+    msg.packet.resize(difop_pkt_length_);
+    for (auto& iter : difop_cb_)
+    {
+      iter(msg);
+    }
+  }
+}
+
+#endif
+
 inline void Input::getDifopPacket()
 {
-  char* precv_buffer = (char*)malloc(difop_pkt_length_);
+  PacketBuffer buffer;
   while (difop_thread_.start_.load())
   {
+    if (buffer.data() == nullptr)
+    {
+      buffer = pkt_pool_->allocate();
+    }
     difop_deadline_->expires_from_now(boost::posix_time::seconds(2));
     boost::system::error_code ec = boost::asio::error::would_block;
     std::size_t ret = 0;
 
-    difop_sock_ptr_->async_receive(boost::asio::buffer(precv_buffer, difop_pkt_length_),
+#ifdef __linux__
+    /* Wait until the socket is readable, then read the packet with its receive time */
+    difop_sock_ptr_->async_receive(boost::asio::null_buffers(),
+                                   boost::bind(&Input::handleReceive, _1, _2, &ec, &ret));
+#else
+    difop_sock_ptr_->async_receive(boost::asio::buffer(buffer.data(), difop_pkt_length_),
                                    boost::bind(&Input::handleReceive, _1, _2, &ec, &ret));
+#endif
     do
     {
       difop_io_service_.run_one();
@@ -324,95 +771,79 @@ inline void Input::getDifopPacket()
       excb_(Error(ERRCODE_DIFOPTIMEOUT));
       continue;
     }
+#ifdef __linux__
+    ssize_t len = recvPacket(difop_sock_ptr_->native_handle(), buffer, difop_pkt_length_, difop_drops_);
+    if (len < 0)
+    {
+      continue;
+    }
+    ret = static_cast<std::size_t>(len);
+#else
+    buffer.setTimestamp(getTime());
+#endif
     if (ret < difop_pkt_length_)
     {
       excb_(Error(ERRCODE_DIFOPINCOMPLETE));
       continue;
     }
-    PacketMsg msg(difop_pkt_length_);
-    memcpy(msg.packet.data(), precv_buffer, difop_pkt_length_);
+    buffer.resize(difop_pkt_length_);
+    PacketMsg msg(std::move(buffer));
     for (auto& iter : difop_cb_)
     {
       iter(msg);
     }
   }
-  free(precv_buffer);
 }
 
 inline void Input::getPcapPacket()
 {
+  bool pace = (input_param_.pcap_replay_mode == PcapReplayMode::PCAP_REPLAY_BY_TIMESTAMP);
+  bool restart_pace = true;
+  double first_pkt_ts = 0;
+  double last_pkt_ts = 0;
+  std::chrono::steady_clock::time_point first_pkt_time;
   while (pcap_thread_.start_.load())
   {
-    struct pcap_pkthdr* header;
-    const u_char* pkt_data;
-    auto time2go = last_packet_time_;
-    switch (lidar_type_)
+    PcapPacket pcap_pkt;
+    if (pcap_reader_.next(pcap_pkt))
     {
-      case LidarType::RS16:
-        time2go += std::chrono::microseconds(static_cast<long long>(RS16_PCAP_SLEEP_DURATION / input_param_.pcap_rate));
-        break;
-      case LidarType::RS32:
-        time2go += std::chrono::microseconds(static_cast<long long>(RS32_PCAP_SLEEP_DURATION / input_param_.pcap_rate));
-        break;
-      case LidarType::RSBP:
-        time2go += std::chrono::microseconds(static_cast<long long>(RSBP_PCAP_SLEEP_DURATION / input_param_.pcap_rate));
-        break;
-      case LidarType::RS128:
-        time2go +=
-            std::chrono::microseconds(static_cast<long long>(RS128_PCAP_SLEEP_DURATION / input_param_.pcap_rate));
-        break;
-      case LidarType::RS80:
-        time2go += std::chrono::microseconds(static_cast<long long>(RS80_PCAP_SLEEP_DURATION / input_param_.pcap_rate));
-        break;
-      case LidarType::RSM1:
-        time2go += std::chrono::microseconds(static_cast<long long>(RSM1_PCAP_SLEEP_DURATION / input_param_.pcap_rate));
-        break;
-      case LidarType::RSHELIOS:
-        time2go +=
-            std::chrono::microseconds(static_cast<long long>(RSHELIOS_PCAP_SLEEP_DURATION / input_param_.pcap_rate));
-        break;
-
-      default:
-        break;
-    }
-    std::this_thread::sleep_until(time2go);
-    last_packet_time_ = std::chrono::system_clock::now();
-    if (!pcap_thread_.start_.load())
-    {
-      break;
-    }
-    if (pcap_next_ex(pcap_, &header, &pkt_data) >= 0)
-    {
-      if (pcap_offline_filter(&pcap_msop_filter_, header, pkt_data) != 0)
+      UdpDatagram udp;
+      bool is_msop;
+      if (!parsePcapPacket(pcap_pkt, udp_parser_, udp, is_msop))
       {
-        PacketMsg msg(msop_pkt_length_);
-        memcpy(msg.packet.data(), pkt_data + 42, msop_pkt_length_);
-        for (auto& iter : msop_cb_)
-        {
-          iter(msg);
-        }
+        continue;
       }
-      else if (pcap_offline_filter(&pcap_difop_filter_, header, pkt_data) != 0)
+      if (pace)
       {
-        PacketMsg msg(difop_pkt_length_);
-        memcpy(msg.packet.data(), pkt_data + 42, difop_pkt_length_);
-        for (auto& iter : difop_cb_)
+        double pkt_ts = pcap_pkt.timestamp;
+        if (restart_pace || pkt_ts < last_pkt_ts || pkt_ts - last_pkt_ts > PCAP_MAX_REPLAY_GAP)
         {
-          iter(msg);
+          restart_pace = false;
+          first_pkt_ts = pkt_ts;
+          first_pkt_time = std::chrono::steady_clock::now();
+        }
+        last_pkt_ts = pkt_ts;
+        std::this_thread::sleep_until(
+            first_pkt_time + std::chrono::microseconds(
+                                 static_cast<long long>((pkt_ts - first_pkt_ts) * 1e6 / input_param_.pcap_rate)));
+        if (!pcap_thread_.start_.load())
+        {
+          break;
         }
       }
-      else
-      {
-        continue;
-      }
+      sendPcapPacket(udp, is_msop);
     }
     else
     {
+      if (pcap_reader_.failed())
+      {
+        excb_(Error(ERRCODE_PCAPCORRUPT));
+      }
       if (input_param_.pcap_repeat)
       {
         excb_(Error(ERRCODE_PCAPREPEAT));
-        char errbuf[PCAP_ERRBUF_SIZE];
-        pcap_ = pcap_open_offline(input_param_.pcap_path.c_str(), errbuf);
+        pcap_reader_.rewind();
+        restart_pace = true;
       }
       else
       {
@@ -423,6 +854,103 @@ inline void Input::getPcapPacket()
   }
 }  // namespace lidar
 
+inline bool Input::parsePcapPacket(const PcapPacket& pcap_pkt, UdpParser& parser, UdpDatagram& udp,
+                                   bool& is_msop) const
+{
+  if (!parser.parse(pcap_pkt, udp))
+  {
+    return false;
+  }
+  if (input_param_.share_port && udp.src_addr != device_addr_)
+  {
+    return false;
+  }
+  is_msop = (udp.dst_port == input_param_.msop_port);
+  uint32_t pkt_length = is_msop ? msop_pkt_length_ : difop_pkt_length_;
+  return (is_msop || udp.dst_port == input_param_.difop_port) && udp.payload_len >= pkt_length;
+}
+
+inline void Input::sendPcapPacket(const UdpDatagram& udp, const bool& is_msop)
+{
+  uint32_t pkt_length = is_msop ? msop_pkt_length_ : difop_pkt_length_;
+  PacketMsg msg(pkt_pool_->allocate());
+  msg.packet.resize(pkt_length);
+  memcpy(msg.packet.data(), udp.payload, pkt_length);  ///< Copied once, messages are kept after the reader moves on
+  for (auto& iter : (is_msop ? msop_cb_ : difop_cb_))
+  {
+    iter(msg);
+  }
+}
+
+/**
+ * @brief Move the pcap replay to the start of a frame. The difop packet of the frame is sent at once. Call it only
+ * while the input is stopped
+ */
+inline bool Input::seekPcap(const PcapIndexEntry& entry)
+{
+  if (!input_param_.read_pcap || !init_flag_)
+  {
+    return false;
+  }
+  PcapPacket pcap_pkt;
+  UdpDatagram udp;
+  bool is_msop;
+  if (entry.has_difop && pcap_reader_.seek(entry.difop) && pcap_reader_.next(pcap_pkt) &&
+      parsePcapPacket(pcap_pkt, udp_parser_, udp, is_msop) && !is_msop)
+  {
+    sendPcapPacket(udp, is_msop);
+  }
+  return pcap_reader_.seek(entry.msop);
+}
+
+/**
+ * @brief Read the whole pcap file once, independently of the replay, and call callback with every lidar packet, the
+ * packet type (true for msop) and the position of the packet. Files which can not be seeked (compressed ones) are not
+ * read, the positions would be of no use
+ */
+inline bool Input::scanPcap(const std::function<void(const uint8_t*, const bool&, const PcapPosition&)>& callback)
+{
+  PcapReader reader;
+  if (!input_param_.read_pcap || !reader.open(input_param_.pcap_path) || !reader.seekable())
+  {
+    return false;
+  }
+  UdpParser parser;
+  PcapPacket pcap_pkt;
+  UdpDatagram udp;
+  bool is_msop;
+  PcapPosition pos = reader.tell();
+  while (reader.next(pcap_pkt))
+  {
+    if (parsePcapPacket(pcap_pkt, parser, udp, is_msop))
+    {
+      callback(udp.payload, is_msop, pos);
+    }
+    pos = reader.tell();
+  }
+  return true;
+}
+
+/**
+ * @brief Describe the pcap file and the packet filter, to tell whether a saved index is up to date
+ */
+inline std::string Input::getPcapKey()
+{
+  PcapReader reader;
+  if (!input_param_.read_pcap || !reader.open(input_param_.pcap_path))
+  {
+    return std::string();
+  }
+  std::stringstream key;
+  key << "size:" << reader.fileSize() << " mtime:" << reader.fileTime() << " lidar:" << lidar_type_
+      << " msop:" << input_param_.msop_port << " difop:" << input_param_.difop_port;
+  if (input_param_.share_port)  ///< Packets of other sources are filtered out
+  {
+    key << " device:" << device_addr_;
+  }
+  return key.str();
+}
+
 inline void Input::checkDifopDeadline()
 {
   if (difop_deadline_->expires_at() <= deadline_timer::traits_type::now())
@@ -0,0 +1,208 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+
+#pragma once
+#include <rs_driver/common/common_header.h>
+#include <rs_driver/utility/thread_pool.hpp>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unordered_map>
+namespace robosense
+{
+namespace lidar
+{
+constexpr int REACTOR_WAIT_MS = 100;    ///< Longest epoll wait, i.e. the resolution of the timeouts
+constexpr int REACTOR_MAX_EVENTS = 64;  ///< Events handled per epoll wait
+
+/**
+ * @brief Input threads shared by several LiDARs. Each loop is one thread waiting with epoll on the sockets given to
+ * it, and calling the read callback of whichever socket is ready. Drivers attached to the reactor also share its
+ * thread pool for decoding, so that N LiDARs need loop_num + decode_thread_num threads instead of 2 input threads
+ * and a pool of MAX_THREAD_NUM threads each. Linux only
+ */
+class InputReactor
+{
+public:
+  typedef std::shared_ptr<InputReactor> Ptr;
+  explicit InputReactor(const size_t& loop_num = 1, const size_t& decode_thread_num = MAX_THREAD_NUM);
+  ~InputReactor();
+  InputReactor(const InputReactor&) = delete;
+  InputReactor& operator=(const InputReactor&) = delete;
+  /**
+   * @brief Watch fd on the least loaded loop. on_readable is called whenever fd is readable, and should read what is
+   * waiting without blocking. on_timeout is called every timeout(s) in which fd was never readable
+   */
+  inline bool add(const int& fd, const std::function<void()>& on_readable, const double& timeout,
+                  const std::function<void()>& on_timeout);
+  inline void remove(const int& fd);  ///< On return, no callback of fd is running or will be called any more
+  inline const ThreadPool::Ptr& threadPool() const
+  {
+    return thread_pool_;
+  }
+
+private:
+  struct Source
+  {
+    std::function<void()> on_readable;
+    std::function<void()> on_timeout;
+    std::chrono::steady_clock::duration timeout;
+    std::chrono::steady_clock::time_point last_time;  ///< Last time fd was readable or timed out
+  };
+
+  struct Loop
+  {
+    int epoll_fd = -1;
+    std::thread thread;
+    std::mutex mutex;  ///< Held while the callbacks run, so that remove() waits for them
+    std::unordered_map<int, Source> sources;
+  };
+
+  inline void runLoop(Loop& loop);
+
+private:
+  std::vector<std::unique_ptr<Loop>> loops_;
+  std::atomic<bool> stop_flag_;
+  ThreadPool::Ptr thread_pool_;
+};
+
+inline InputReactor::InputReactor(const size_t& loop_num, const size_t& decode_thread_num)
+  : stop_flag_(false), thread_pool_(std::make_shared<ThreadPool>(decode_thread_num))
+{
+  for (size_t i = 0; i < std::max<size_t>(loop_num, 1); i++)
+  {
+    std::unique_ptr<Loop> loop(new Loop);
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0)
+    {
+      RS_ERROR << "Failed to create an epoll instance: " << strerror(errno) << RS_REND;
+      continue;
+    }
+    Loop* ptr = loop.get();
+    loop->thread = std::thread([this, ptr]() { runLoop(*ptr); });
+    loops_.emplace_back(std::move(loop));
+  }
+}
+
+inline InputReactor::~InputReactor()
+{
+  stop_flag_.store(true);
+  for (auto& loop : loops_)
+  {
+    loop->thread.join();
+    close(loop->epoll_fd);
+  }
+}
+
+inline bool InputReactor::add(const int& fd, const std::function<void()>& on_readable, const double& timeout,
+                              const std::function<void()>& on_timeout)
+{
+  Loop* target = nullptr;
+  size_t min_num = SIZE_MAX;
+  for (auto& loop : loops_)
+  {
+    std::lock_guard<std::mutex> lock(loop->mutex);
+    if (loop->sources.size() < min_num)
+    {
+      min_num = loop->sources.size();
+      target = loop.get();
+    }
+  }
+  if (target == nullptr)
+  {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(target->mutex);
+  Source& source = target->sources[fd];
+  source.on_readable = on_readable;
+  source.on_timeout = on_timeout;
+  source.timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(timeout));
+  source.last_time = std::chrono::steady_clock::now();
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+  if (epoll_ctl(target->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+  {
+    RS_ERROR << "Failed to add socket " << fd << " to epoll: " << strerror(errno) << RS_REND;
+    target->sources.erase(fd);
+    return false;
+  }
+  return true;
+}
+
+inline void InputReactor::remove(const int& fd)
+{
+  for (auto& loop : loops_)
+  {
+    std::lock_guard<std::mutex> lock(loop->mutex);
+    if (loop->sources.erase(fd) != 0)
+    {
+      epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+      return;
+    }
+  }
+}
+
+inline void InputReactor::runLoop(Loop& loop)
+{
+  struct epoll_event events[REACTOR_MAX_EVENTS];
+  while (!stop_flag_.load())
+  {
+    int num = epoll_wait(loop.epoll_fd, events, REACTOR_MAX_EVENTS, REACTOR_WAIT_MS);
+    std::lock_guard<std::mutex> lock(loop.mutex);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (int i = 0; i < num; i++)
+    {
+      auto iter = loop.sources.find(events[i].data.fd);
+      if (iter == loop.sources.end())  ///< Removed after the wait returned
+      {
+        continue;
+      }
+      iter->second.last_time = now;
+      iter->second.on_readable();
+    }
+    for (auto& iter : loop.sources)
+    {
+      if (now - iter.second.last_time >= iter.second.timeout)
+      {
+        iter.second.last_time = now;
+        iter.second.on_timeout();
+      }
+    }
+  }
+}
+
+}  // namespace lidar
+}  // namespace robosense
+#endif
@@ -32,15 +32,22 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 #include <rs_driver/msg/point_cloud_msg.h>
+#include <rs_driver/msg/point_cloud_soa_msg.h>
 #include <rs_driver/msg/packet_msg.h>
 #include <rs_driver/msg/scan_msg.h>
+#include <rs_driver/utility/frame_pool.h>
 #include <rs_driver/utility/lock_queue.h>
+#include <rs_driver/utility/spsc_queue.h>
 #include <rs_driver/utility/thread_pool.hpp>
 #include <rs_driver/utility/time.h>
 #include <rs_driver/common/error_code.h>
 #include <rs_driver/driver/input.hpp>
+#include <rs_driver/driver/pcap_writer.hpp>
 #include <rs_driver/driver/decoder/decoder_factory.hpp>
 constexpr size_t MAX_PACKETS_BUFFER_SIZE = 100000;
+constexpr size_t MSOP_POP_BATCH_SIZE = 64;
+constexpr size_t SCAN_DECODE_MIN_PKTS_PER_THREAD = 64;  ///< decodeMsopScan() does not split a scan any finer
+constexpr size_t SHARED_POOL_BATCHES_PER_TASK = 16;     ///< Batches a decode task takes before it yields a shared pool
 namespace robosense
 {
 namespace lidar
@@ -56,41 +63,92 @@ public:
   bool start();
   void stop();
   void regRecvCallback(const std::function<void(const PointCloudMsg<T_Point>&)>& callback);
+  void regRecvCallback(const std::function<void(const PointCloudSoAMsg&)>& callback);
   void regRecvCallback(const std::function<void(const ScanMsg&)>& callback);
   void regRecvCallback(const std::function<void(const PacketMsg&)>& callback);
   void regRecvCallback(const std::function<void(const CameraTrigger&)>& callback);
   void regExceptionCallback(const std::function<void(const Error&)>& callback);
   bool getLidarTemperature(double& input_temperature);
+  bool setTransformParam(const RSTransformParam& param);
   bool decodeMsopScan(const ScanMsg& scan_msg, PointCloudMsg<T_Point>& point_cloud_msg);
+  bool decodeMsopScan(const ScanMsg& scan_msg, PointCloudSoAMsg& point_cloud_msg);
+  RSDecoderResult prepareMsopPkt(const PacketMsg& msg, PacketContext& ctx);
+  void decodePacket(const PacketMsg& msg, const PacketContext& ctx,
+                    CloudSlice<typename PointCloudMsg<T_Point>::PointCloud>& cloud) const;
+  void decodePacket(const PacketMsg& msg, const PacketContext& ctx, CloudSlice<PointCloudSoA>& cloud) const;
   void decodeDifopPkt(const PacketMsg& msg);
+  bool seekFrame(const uint32_t& frame);
+  bool seekTime(const double& timestamp);
+  bool getStatistics(RSDriverStatistics& stats);
+#ifdef __linux__
+  bool setInputReactor(const InputReactor::Ptr& reactor);
+#endif
 
 private:
   void runCallBack(const ScanMsg& msg);
   void runCallBack(const PacketMsg& msg);
   void runCallBack(const PointCloudMsg<T_Point>& msg);
+  void runCallBack(const PointCloudSoAMsg& msg);
   void reportError(const Error& error);
   void msopCallback(const PacketMsg& msg);
+  void msopBatchCallback(const std::vector<PacketMsg>& msgs);
   void difopCallback(const PacketMsg& msg);
+  void scheduleMsop();
   void processMsop();
+  void decodeThreadLoop();
+  void startDecodeThread();
+  void stopDecodeThread();
+  void processMsopQueue(const size_t& max_batches = SIZE_MAX);
+  void commitMsopTask();
   void processDifop();
   void localCameraTriggerCallback(const CameraTrigger& msg);
-  void initPointCloudTransFunc();
+  void initRowMajorCloud();
+  bool loadPcapIndex();
+  bool seekPcap(const PcapIndexEntry& entry);
+  RSDecoderResult decodeMsopPkt(const PacketMsg& pkt, int& height);
+  static double getRecvTime(const PacketMsg& pkt);  ///< Receive time of the packet, or the current time if unknown
+  template <typename T_Cloud>
+  void decodeScanPackets(const ScanMsg& scan_msg, const std::vector<PacketContext>& pkt_ctx,
+                         const std::vector<size_t>& pkt_offset, T_Cloud& point_cloud, const size_t& height,
+                         const size_t& stride);
   void setScanMsgHeader(ScanMsg& msg);
   void setPointCloudMsgHeader(PointCloudMsg<T_Point>& msg);
+  void setPointCloudMsgHeader(PointCloudSoAMsg& msg);
+  void publishPointCloud(const int& height, const double& timestamp);
+  void publishPointCloudSoA(const int& height, const double& timestamp);
+  typename PointCloudMsg<T_Point>::PointCloudPtr convertPointCloud(const PointCloudSoA& cloud);
+  template <typename T_Msg>
+  bool decodeMsopScanImpl(const ScanMsg& scan_msg, T_Msg& point_cloud_msg,
+                          const typename FramePool<typename T_Msg::PointCloud>::Ptr& pool);
 
 private:
-  Queue<PacketMsg> msop_pkt_queue_;
+  SPSCQueue<PacketMsg> msop_pkt_queue_;
+  std::vector<PacketMsg> msop_pkt_batch_;
+  std::atomic<bool> msop_task_scheduled_;
+  Thread decode_thread_;
+  std::atomic<bool> decode_thread_waiting_;
+  std::mutex decode_mutex_;
+  std::condition_variable decode_cv_;
   Queue<PacketMsg> difop_pkt_queue_;
   std::vector<std::function<void(const ScanMsg&)>> msop_pkt_cb_vec_;
   std::vector<std::function<void(const PacketMsg&)>> difop_pkt_cb_vec_;
   std::vector<std::function<void(const PointCloudMsg<T_Point>&)>> point_cloud_cb_vec_;
+  std::vector<std::function<void(const PointCloudSoAMsg&)>> point_cloud_soa_cb_vec_;
   std::vector<std::function<void(const CameraTrigger&)>> camera_trigger_cb_vec_;
   std::vector<std::function<void(const Error&)>> excb_;
   std::shared_ptr<std::thread> lidar_thread_ptr_;
   std::shared_ptr<DecoderBase<T_Point>> lidar_decoder_ptr_;
   std::shared_ptr<Input> input_ptr_;
+  std::shared_ptr<PcapWriter> recorder_ptr_;
   std::shared_ptr<ScanMsg> scan_ptr_;
-  std::shared_ptr<ThreadPool> thread_pool_ptr_;
+  std::shared_ptr<ThreadPool> thread_pool_ptr_;  ///< Own pool, or the one of the reactor
+  std::atomic<int> pending_tasks_;              ///< Tasks committed to the pool and not finished yet
+  std::atomic<uint64_t> msop_pkt_num_;
+  std::atomic<uint64_t> difop_pkt_num_;
+  std::atomic<uint64_t> msop_queue_drops_;
+#ifdef __linux__
+  InputReactor::Ptr reactor_ptr_;
+#endif
   bool init_flag_;
   bool start_flag_;
   bool difop_flag_;
@@ -98,18 +156,34 @@ private:
   uint32_t scan_seq_;
   uint32_t ndifop_count_;
   RSDriverParam driver_param_;
-  std::function<typename PointCloudMsg<T_Point>::PointCloudPtr(const typename PointCloudMsg<T_Point>::PointCloudPtr,
-                                                               const size_t& height)>
-      point_cloud_transform_func_;
   typename PointCloudMsg<T_Point>::PointCloudPtr point_cloud_ptr_;
+  PointCloudSoAMsg::PointCloudPtr point_cloud_soa_ptr_;  ///< Decoder output if any PointCloudSoAMsg callback exists
+  typename FramePool<typename PointCloudMsg<T_Point>::PointCloud>::Ptr point_cloud_pool_;
+  FramePool<PointCloudSoA>::Ptr point_cloud_soa_pool_;
+  RowMajorCloud<typename PointCloudMsg<T_Point>::PointCloud> row_major_cloud_;  ///< Wraps point_cloud_ptr_
+  RowMajorCloud<PointCloudSoA> row_major_soa_cloud_;                            ///< Wraps point_cloud_soa_ptr_
+  std::vector<PacketContext> scan_pkt_ctx_;  ///< Of the packets of the scan decodeMsopScan() decodes, kept to be reused
+  std::vector<size_t> scan_pkt_offset_;      ///< Index in the frame of the first point of each packet
+  PcapIndex pcap_index_;  ///< Loaded or built by the first seek
+  std::mutex seek_mutex_;
 };
 
 template <typename T_Point>
 inline LidarDriverImpl<T_Point>::LidarDriverImpl()
-  : init_flag_(false), start_flag_(false), difop_flag_(false), point_cloud_seq_(0), scan_seq_(0), ndifop_count_(0)
+  : msop_pkt_queue_(MAX_PACKETS_BUFFER_SIZE)
+  , msop_task_scheduled_(false)
+  , decode_thread_waiting_(false)
+  , pending_tasks_(0)
+  , msop_pkt_num_(0)
+  , difop_pkt_num_(0)
+  , msop_queue_drops_(0)
+  , init_flag_(false), start_flag_(false), difop_flag_(false), point_cloud_seq_(0), scan_seq_(0), ndifop_count_(0)
 {
-  thread_pool_ptr_ = std::make_shared<ThreadPool>();
-  point_cloud_ptr_ = std::make_shared<typename PointCloudMsg<T_Point>::PointCloud>();
+  msop_pkt_batch_.reserve(MSOP_POP_BATCH_SIZE);
+  point_cloud_pool_ = std::make_shared<FramePool<typename PointCloudMsg<T_Point>::PointCloud>>();
+  point_cloud_soa_pool_ = std::make_shared<FramePool<PointCloudSoA>>();
+  point_cloud_ptr_ = point_cloud_pool_->allocate(0);
+  point_cloud_soa_ptr_ = point_cloud_soa_pool_->allocate(0);
   scan_ptr_ = std::make_shared<ScanMsg>();
 }
 
@@ -117,6 +191,10 @@ template <typename T_Point>
 inline LidarDriverImpl<T_Point>::~LidarDriverImpl()
 {
   stop();
+  while (pending_tasks_.load() > 0)  ///< A pool shared with other drivers may still run tasks of this one
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
   thread_pool_ptr_.reset();
   input_ptr_.reset();
 }
@@ -129,19 +207,34 @@ inline bool LidarDriverImpl<T_Point>::init(const RSDriverParam& param)
     return false;
   }
   driver_param_ = param;
+  if (thread_pool_ptr_ == nullptr)
+  {
+    thread_pool_ptr_ = std::make_shared<ThreadPool>();
+  }
   input_ptr_ = std::make_shared<Input>(driver_param_.lidar_type, driver_param_.input_param,
                                        std::bind(&LidarDriverImpl<T_Point>::reportError, this, std::placeholders::_1));
+#ifdef __linux__
+  input_ptr_->setReactor(reactor_ptr_);
+#endif
   input_ptr_->regRecvMsopCallback(std::bind(&LidarDriverImpl<T_Point>::msopCallback, this, std::placeholders::_1));
   input_ptr_->regRecvDifopCallback(std::bind(&LidarDriverImpl<T_Point>::difopCallback, this, std::placeholders::_1));
+  input_ptr_->regRecvMsopBatchCallback(
+      std::bind(&LidarDriverImpl<T_Point>::msopBatchCallback, this, std::placeholders::_1));
   if (!input_ptr_->init())
   {
     return false;
   }
+  if (!driver_param_.recorder_param.record_path.empty())
+  {
+    recorder_ptr_ = std::make_shared<PcapWriter>(
+        driver_param_.recorder_param, driver_param_.input_param.device_ip,
+        std::bind(&LidarDriverImpl<T_Point>::reportError, this, std::placeholders::_1));
+  }
   lidar_decoder_ptr_ = DecoderFactory<T_Point>::createDecoder(driver_param_);
   lidar_decoder_ptr_->regRecvCallback(
       std::bind(&LidarDriverImpl<T_Point>::localCameraTriggerCallback, this, std::placeholders::_1));
   init_flag_ = true;
-  initPointCloudTransFunc();
+  initRowMajorCloud();
   return true;
 }
 
@@ -153,42 +246,40 @@ inline void LidarDriverImpl<T_Point>::initDecoderOnly(const RSDriverParam& param
     return;
   }
   driver_param_ = param;
+  if (thread_pool_ptr_ == nullptr)
+  {
+    thread_pool_ptr_ = std::make_shared<ThreadPool>();
+  }
   lidar_decoder_ptr_ = DecoderFactory<T_Point>::createDecoder(driver_param_);
   lidar_decoder_ptr_->regRecvCallback(
       std::bind(&LidarDriverImpl<T_Point>::localCameraTriggerCallback, this, std::placeholders::_1));
   init_flag_ = true;
-  initPointCloudTransFunc();
+  initRowMajorCloud();
 }
 
+#ifdef __linux__
 template <typename T_Point>
-inline void LidarDriverImpl<T_Point>::initPointCloudTransFunc()
+inline bool LidarDriverImpl<T_Point>::setInputReactor(const InputReactor::Ptr& reactor)
 {
-  if (driver_param_.saved_by_rows)
+  if (init_flag_ || reactor == nullptr)
   {
-    point_cloud_transform_func_ = [](const typename PointCloudMsg<T_Point>::PointCloudPtr input_ptr,
-                                     const size_t& height) -> typename PointCloudMsg<T_Point>::PointCloudPtr
-    {
-      typename PointCloudMsg<T_Point>::PointCloudPtr row_major_ptr =
-          std::make_shared<typename PointCloudMsg<T_Point>::PointCloud>();
-      row_major_ptr->resize(input_ptr->size());
-      size_t width = input_ptr->size() / height;
-      for (int i = 0; i < static_cast<int>(height); i++)
-      {
-        for (int j = 0; j < static_cast<int>(width); j++)
-        {
-          row_major_ptr->at(i * width + j) = input_ptr->at(j * height + i);
-        }
-      }
-      return row_major_ptr;
-    };
+    return false;
   }
-  else
+  reactor_ptr_ = reactor;
+  thread_pool_ptr_ = reactor->threadPool();
+  return true;
+}
+#endif
+
+template <typename T_Point>
+inline void LidarDriverImpl<T_Point>::initRowMajorCloud()
+{
+  if (driver_param_.saved_by_rows)  ///< The frames grow to their full size on the first decoded block
   {
-    point_cloud_transform_func_ = [](const typename PointCloudMsg<T_Point>::PointCloudPtr input_ptr,
-                                     const size_t& height) -> typename PointCloudMsg<T_Point>::PointCloudPtr
-    {
-      return input_ptr;
-    };
+    size_t height = lidar_decoder_ptr_->getHeight();
+    size_t max_width = lidar_decoder_ptr_->getMaxPointsPerFrame() / height;
+    row_major_cloud_.reset(*point_cloud_ptr_, height, 0, max_width);
+    row_major_soa_cloud_.reset(*point_cloud_soa_ptr_, height, 0, max_width);
   }
 }
 
@@ -200,6 +291,14 @@ inline bool LidarDriverImpl<T_Point>::start()
     return false;
   }
   start_flag_ = true;
+  if (driver_param_.use_decode_thread)
+  {
+    startDecodeThread();
+  }
+  if (recorder_ptr_ != nullptr)
+  {
+    recorder_ptr_->start();  ///< A recorder failing to open its file reports ERRCODE_RECORDFAILED, the driver goes on
+  }
   return input_ptr_->start();
 }
 
@@ -210,6 +309,11 @@ inline void LidarDriverImpl<T_Point>::stop()
   {
     input_ptr_->stop();
   }
+  if (recorder_ptr_ != nullptr)
+  {
+    recorder_ptr_->stop();
+  }
+  stopDecodeThread();
   start_flag_ = false;
   if (!msop_pkt_cb_vec_.empty() || !difop_pkt_cb_vec_.empty())
   {
@@ -224,6 +328,12 @@ LidarDriverImpl<T_Point>::regRecvCallback(const std::function<void(const PointCl
   point_cloud_cb_vec_.emplace_back(callback);
 }
 
+template <typename T_Point>
+inline void LidarDriverImpl<T_Point>::regRecvCallback(const std::function<void(const PointCloudSoAMsg&)>& callback)
+{
+  point_cloud_soa_cb_vec_.emplace_back(callback);
+}
+
 template <typename T_Point>
 inline void LidarDriverImpl<T_Point>::regRecvCallback(const std::function<void(const ScanMsg&)>& callback)
 {
@@ -259,11 +369,72 @@ inline bool LidarDriverImpl<T_Point>::getLidarTemperature(double& input_temperat
   return false;
 }
 
+template <typename T_Point>
+inline bool LidarDriverImpl<T_Point>::getStatistics(RSDriverStatistics& stats)
+{
+  if (input_ptr_ == nullptr)
+  {
+    return false;
+  }
+  stats = RSDriverStatistics();
+  stats.msop_pkts = msop_pkt_num_.load();
+  stats.difop_pkts = difop_pkt_num_.load();
+  stats.msop_queue_drops = msop_queue_drops_.load();
+  input_ptr_->getStatistics(stats);
+  return true;
+}
+
+template <typename T_Point>
+inline bool LidarDriverImpl<T_Point>::setTransformParam(const RSTransformParam& param)
+{
+  if (lidar_decoder_ptr_ != nullptr)
+  {
+    driver_param_.decoder_param.transform_param = param;
+    lidar_decoder_ptr_->setTransformParam(param);
+    return true;
+  }
+  return false;
+}
+
 template <typename T_Point>
 inline bool LidarDriverImpl<T_Point>::decodeMsopScan(const ScanMsg& scan_msg, PointCloudMsg<T_Point>& point_cloud_msg)
 {
-  typename PointCloudMsg<T_Point>::PointCloudPtr output_point_cloud_ptr =
-      std::make_shared<typename PointCloudMsg<T_Point>::PointCloud>();
+  return decodeMsopScanImpl(scan_msg, point_cloud_msg, point_cloud_pool_);
+}
+
+template <typename T_Point>
+inline bool LidarDriverImpl<T_Point>::decodeMsopScan(const ScanMsg& scan_msg, PointCloudSoAMsg& point_cloud_msg)
+{
+  return decodeMsopScanImpl(scan_msg, point_cloud_msg, point_cloud_soa_pool_);
+}
+
+template <typename T_Point>
+inline RSDecoderResult LidarDriverImpl<T_Point>::prepareMsopPkt(const PacketMsg& msg, PacketContext& ctx)
+{
+  lidar_decoder_ptr_->setRecvTime(msg.packet.timestamp());
+  return lidar_decoder_ptr_->prepareMsopPkt(msg.packet.data(), ctx);
+}
+
+template <typename T_Point>
+inline void LidarDriverImpl<T_Point>::decodePacket(const PacketMsg& msg, const PacketContext& ctx,
+                                                   CloudSlice<typename PointCloudMsg<T_Point>::PointCloud>& cloud) const
+{
+  lidar_decoder_ptr_->decodePacket(msg.packet.data(), ctx, cloud);
+}
+
+template <typename T_Point>
+inline void LidarDriverImpl<T_Point>::decodePacket(const PacketMsg& msg, const PacketContext& ctx,
+                                                   CloudSlice<PointCloudSoA>& cloud) const
+{
+  lidar_decoder_ptr_->decodePacket(msg.packet.data(), ctx, cloud);
+}
+
+template <typename T_Point>
+template <typename T_Msg>
+inline bool
+LidarDriverImpl<T_Point>::decodeMsopScanImpl(const ScanMsg& scan_msg, T_Msg& point_cloud_msg,
+                                             const typename FramePool<typename T_Msg::PointCloud>::Ptr& pool)
+{
   if (!difop_flag_ && driver_param_.wait_for_difop)
   {
     ndifop_count_++;
@@ -272,25 +443,24 @@ inline bool LidarDriverImpl<T_Point>::decodeMsopScan(const ScanMsg& scan_msg, Po
       reportError(Error(ERRCODE_NODIFOPRECV));
       ndifop_count_ = 0;
     }
-    point_cloud_msg.point_cloud_ptr = output_point_cloud_ptr;
+    point_cloud_msg.point_cloud_ptr = pool->allocate(0);
     std::this_thread::sleep_for(std::chrono::milliseconds(10));
     return false;
   }
 
-  std::vector<std::vector<T_Point>> pointcloud_one_frame;
+  /* Prepare the packets in order, so that they can be decoded in any order into their parts of the frame */
+  std::vector<PacketContext>& pkt_ctx = scan_pkt_ctx_;
+  std::vector<size_t>& pkt_offset = scan_pkt_offset_;
+  pkt_ctx.assign(scan_msg.packets.size(), PacketContext());  ///< A rejected packet leaves its context as it is
+  pkt_offset.resize(scan_msg.packets.size());
+  size_t point_num = 0;
   int height = 1;
-  pointcloud_one_frame.resize(scan_msg.packets.size());
-  for (int i = 0; i < static_cast<int>(scan_msg.packets.size()); i++)
+  for (size_t i = 0; i < scan_msg.packets.size(); i++)
   {
-    std::vector<T_Point> pointcloud_one_packet;
-    RSDecoderResult ret =
-        lidar_decoder_ptr_->processMsopPkt(scan_msg.packets[i].packet.data(), pointcloud_one_packet, height);
+    lidar_decoder_ptr_->setRecvTime(scan_msg.packets[i].packet.timestamp());
+    RSDecoderResult ret = lidar_decoder_ptr_->prepareMsopPkt(scan_msg.packets[i].packet.data(), pkt_ctx[i]);
     switch (ret)
     {
-      case RSDecoderResult::DECODE_OK:
-      case RSDecoderResult::FRAME_SPLIT:
-        pointcloud_one_frame[i] = std::move(pointcloud_one_packet);
-        break;
       case RSDecoderResult::WRONG_PKT_HEADER:
         reportError(Error(ERRCODE_WRONGPKTHEADER));
         break;
@@ -300,14 +470,29 @@ inline bool LidarDriverImpl<T_Point>::decodeMsopScan(const ScanMsg& scan_msg, Po
       default:
         break;
     }
+    if (pkt_ctx[i].point_num != 0)
+    {
+      height = pkt_ctx[i].height;
+    }
+    pkt_offset[i] = point_num;
+    point_num += pkt_ctx[i].point_num;
   }
-  for (auto iter : pointcloud_one_frame)
+  size_t width = driver_param_.saved_by_rows ? (point_num + height - 1) / height : point_num / height;
+  typename T_Msg::PointCloudPtr output_point_cloud_ptr;
+  if (driver_param_.saved_by_rows && height * width != point_num)
   {
-    output_point_cloud_ptr->insert(output_point_cloud_ptr->end(), iter.begin(), iter.end());
+    output_point_cloud_ptr = pool->allocate(height * width);  ///< The unfilled end of the last column stays empty
+    output_point_cloud_ptr->resize(height * width);
   }
-  point_cloud_msg.point_cloud_ptr = point_cloud_transform_func_(output_point_cloud_ptr, height);
+  else
+  {
+    output_point_cloud_ptr = pool->allocateResized(point_num);  ///< Every point is decoded, none is initialized
+  }
+  decodeScanPackets(scan_msg, pkt_ctx, pkt_offset, *output_point_cloud_ptr, height,
+                    driver_param_.saved_by_rows ? width : 0);
+  point_cloud_msg.point_cloud_ptr = output_point_cloud_ptr;
   point_cloud_msg.height = height;
-  point_cloud_msg.width = point_cloud_msg.point_cloud_ptr->size() / point_cloud_msg.height;
+  point_cloud_msg.width = width;
   setPointCloudMsgHeader(point_cloud_msg);
   point_cloud_msg.timestamp = scan_msg.timestamp;
   if (point_cloud_msg.point_cloud_ptr->size() == 0)
@@ -318,6 +503,35 @@ inline bool LidarDriverImpl<T_Point>::decodeMsopScan(const ScanMsg& scan_msg, Po
   return true;
 }
 
+/**
+ * @brief Decode the prepared packets of a scan into point_cloud, which is already sized for the whole frame. The
+ * packets are split into ranges which are decoded on the thread pool and the calling thread at the same time
+ */
+template <typename T_Point>
+template <typename T_Cloud>
+inline void LidarDriverImpl<T_Point>::decodeScanPackets(const ScanMsg& scan_msg,
+                                                        const std::vector<PacketContext>& pkt_ctx,
+                                                        const std::vector<size_t>& pkt_offset, T_Cloud& point_cloud,
+                                                        const size_t& height, const size_t& stride)
+{
+  static const size_t core_num = std::max(1u, std::thread::hardware_concurrency());  ///< More ranges only switch
+  const size_t pkt_num = scan_msg.packets.size();
+  const size_t range_num = std::max<size_t>(
+      1, std::min<size_t>(std::min<size_t>(MAX_THREAD_NUM + 1, core_num), pkt_num / SCAN_DECODE_MIN_PKTS_PER_THREAD));
+  thread_pool_ptr_->parallelFor(range_num, [&](size_t range) {
+    const size_t begin = pkt_num * range / range_num;
+    const size_t end = pkt_num * (range + 1) / range_num;
+    CloudSlice<T_Cloud> slice(point_cloud, begin < pkt_num ? pkt_offset[begin] : 0, height, stride);
+    for (size_t i = begin; i < end; i++)
+    {
+      if (pkt_ctx[i].point_num != 0)
+      {
+        lidar_decoder_ptr_->decodePacket(scan_msg.packets[i].packet.data(), pkt_ctx[i], slice);
+      }
+    }
+  });
+}
+
 template <typename T_Point>
 inline void LidarDriverImpl<T_Point>::decodeDifopPkt(const PacketMsg& msg)
 {
@@ -325,6 +539,120 @@ inline void LidarDriverImpl<T_Point>::decodeDifopPkt(const PacketMsg& msg)
   difop_flag_ = true;
 }
 
+template <typename T_Point>
+inline bool LidarDriverImpl<T_Point>::seekFrame(const uint32_t& frame)
+{
+  std::lock_guard<std::mutex> lock(seek_mutex_);
+  if (!loadPcapIndex() || frame >= pcap_index_.size())
+  {
+    return false;
+  }
+  return seekPcap(pcap_index_[frame]);
+}
+
+template <typename T_Point>
+inline bool LidarDriverImpl<T_Point>::seekTime(const double& timestamp)
+{
+  std::lock_guard<std::mutex> lock(seek_mutex_);
+  if (!loadPcapIndex() || pcap_index_.empty())
+  {
+    return false;
+  }
+  return seekPcap(pcap_index_[pcap_index_.findFrame(timestamp)]);
+}
+
+template <typename T_Point>
+inline bool LidarDriverImpl<T_Point>::loadPcapIndex()
+{
+  if (!pcap_index_.empty())
+  {
+    return true;
+  }
+  if (input_ptr_ == nullptr || !driver_param_.input_param.read_pcap)
+  {
+    return false;
+  }
+  const RSDecoderParam& decoder_param = driver_param_.decoder_param;
+  std::stringstream key;
+  key << input_ptr_->getPcapKey() << " split:" << decoder_param.split_frame_mode
+      << " pkts:" << decoder_param.num_pkts_split << " cut:" << decoder_param.cut_angle;
+  std::string index_path = driver_param_.input_param.pcap_path + PCAP_INDEX_SUFFIX;
+  if (pcap_index_.load(index_path, key.str()))
+  {
+    return true;
+  }
+  RS_INFO << "Indexing " << driver_param_.input_param.pcap_path << " ..." << RS_REND;
+  std::shared_ptr<DecoderBase<T_Point>> decoder = DecoderFactory<T_Point>::createDecoder(driver_param_);
+  PcapIndexEntry entry;
+  bool frame_start = true;
+  bool ret = input_ptr_->scanPcap([&](const uint8_t* pkt, const bool& is_msop, const PcapPosition& pos) {
+    if (!is_msop)
+    {
+      decoder->processDifopPkt(pkt);
+      entry.difop = pos;
+      entry.has_difop = true;
+      return;
+    }
+    PacketContext ctx;
+    RSDecoderResult result = decoder->prepareMsopPkt(pkt, ctx);
+    if (result != DECODE_OK && result != FRAME_SPLIT)
+    {
+      return;
+    }
+    if (frame_start)
+    {
+      entry.msop = pos;
+      entry.timestamp = decoder->getLidarTime(pkt);
+      pcap_index_.addFrame(entry);
+    }
+    frame_start = (result == FRAME_SPLIT);  ///< The splitting packet is the last one of its frame
+  });
+  if (!ret || pcap_index_.empty())
+  {
+    pcap_index_.clear();
+    return false;
+  }
+  if (!pcap_index_.save(index_path, key.str()))
+  {
+    RS_WARNING << "Failed to save the pcap index to " << index_path << RS_REND;
+  }
+  return true;
+}
+
+template <typename T_Point>
+inline bool LidarDriverImpl<T_Point>::seekPcap(const PcapIndexEntry& entry)
+{
+  bool started = start_flag_;
+  input_ptr_->stop();
+  stopDecodeThread();
+  while (msop_task_scheduled_.load() || (!driver_param_.use_decode_thread && !msop_pkt_queue_.empty()))
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));  ///< Let the pool task drain the queue
+  }
+  msop_pkt_queue_.clear();
+  scan_ptr_->packets.clear();
+  point_cloud_ptr_->clear();
+  point_cloud_soa_ptr_->clear();
+  initRowMajorCloud();
+  lidar_decoder_ptr_->restartFrame();
+  scan_seq_ = std::max(scan_seq_, 1u);  ///< Unlike the first frame after start, the frame sought to is complete
+  point_cloud_seq_ = std::max(point_cloud_seq_, 1u);
+  bool ret = input_ptr_->seekPcap(entry);
+  while (!difop_pkt_queue_.is_task_finished_.load())
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));  ///< Decode the difop packet before the frame
+  }
+  if (started)
+  {
+    if (driver_param_.use_decode_thread)
+    {
+      startDecodeThread();
+    }
+    input_ptr_->start();
+  }
+  return ret;
+}
+
 template <typename T_Point>
 inline void LidarDriverImpl<T_Point>::runCallBack(const ScanMsg& msg)
 {
@@ -358,6 +686,18 @@ inline void LidarDriverImpl<T_Point>::runCallBack(const PointCloudMsg<T_Point>&
   }
 }
 
+template <typename T_Point>
+inline void LidarDriverImpl<T_Point>::runCallBack(const PointCloudSoAMsg& msg)
+{
+  if (msg.seq != 0)
+  {
+    for (auto& it : point_cloud_soa_cb_vec_)
+    {
+      it(msg);
+    }
+  }
+}
+
 template <typename T_Point>
 inline void LidarDriverImpl<T_Point>::reportError(const Error& error)
 {
@@ -370,32 +710,97 @@ inline void LidarDriverImpl<T_Point>::reportError(const Error& error)
 template <typename T_Point>
 inline void LidarDriverImpl<T_Point>::msopCallback(const PacketMsg& msg)
 {
-  if (msop_pkt_queue_.size() > MAX_PACKETS_BUFFER_SIZE)
+  msop_pkt_num_.fetch_add(1, std::memory_order_relaxed);
+  bool wait = driver_param_.input_param.read_pcap &&
+              driver_param_.input_param.pcap_replay_mode == PcapReplayMode::PCAP_REPLAY_MAX_THROUGHPUT;
+  while (!msop_pkt_queue_.push(msg))
+  {
+    if (!wait)
+    {
+      msop_queue_drops_.fetch_add(1, std::memory_order_relaxed);
+      reportError(Error(ERRCODE_PKTBUFOVERFLOW));
+      break;
+    }
+    scheduleMsop();  ///< Max throughput replay waits for the decoder to drain the queue
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  scheduleMsop();
+  if (recorder_ptr_ != nullptr)  ///< After the packet is handed to the decoder, so recording adds no latency
+  {
+    recorder_ptr_->record(msg, driver_param_.input_param.msop_port, getRecvTime(msg));
+  }
+}
+
+template <typename T_Point>
+inline void LidarDriverImpl<T_Point>::msopBatchCallback(const std::vector<PacketMsg>& msgs)
+{
+  msop_pkt_num_.fetch_add(msgs.size(), std::memory_order_relaxed);
+  size_t pushed = msop_pkt_queue_.push(msgs);
+  if (pushed < msgs.size())
   {
+    msop_queue_drops_.fetch_add(msgs.size() - pushed, std::memory_order_relaxed);
     reportError(Error(ERRCODE_PKTBUFOVERFLOW));
-    msop_pkt_queue_.clear();
   }
-  msop_pkt_queue_.push(msg);
-  if (msop_pkt_queue_.is_task_finished_.load())
+  scheduleMsop();
+  if (recorder_ptr_ != nullptr)
   {
-    msop_pkt_queue_.is_task_finished_.store(false);
-    thread_pool_ptr_->commit([this]() { processMsop(); });
+    for (const auto& msg : msgs)
+    {
+      recorder_ptr_->record(msg, driver_param_.input_param.msop_port, getRecvTime(msg));
+    }
   }
 }
 
+template <typename T_Point>
+inline void LidarDriverImpl<T_Point>::scheduleMsop()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (driver_param_.use_decode_thread)
+  {
+    if (decode_thread_waiting_.load())
+    {
+      std::lock_guard<std::mutex> lock(decode_mutex_);
+      decode_cv_.notify_one();
+    }
+  }
+  else if (!msop_task_scheduled_.exchange(true))
+  {
+    commitMsopTask();
+  }
+}
+
+template <typename T_Point>
+inline void LidarDriverImpl<T_Point>::commitMsopTask()
+{
+  pending_tasks_++;
+  thread_pool_ptr_->commit([this]() {
+    processMsop();
+    pending_tasks_--;
+  });
+}
+
 template <typename T_Point>
 inline void LidarDriverImpl<T_Point>::difopCallback(const PacketMsg& msg)
 {
+  difop_pkt_num_.fetch_add(1, std::memory_order_relaxed);
   difop_pkt_queue_.push(msg);
   if (difop_pkt_queue_.is_task_finished_.load())
   {
     difop_pkt_queue_.is_task_finished_.store(false);
-    thread_pool_ptr_->commit([this]() { processDifop(); });
+    pending_tasks_++;
+    thread_pool_ptr_->commit([this]() {
+      processDifop();
+      pending_tasks_--;
+    });
+  }
+  if (recorder_ptr_ != nullptr)
+  {
+    recorder_ptr_->record(msg, driver_param_.input_param.difop_port, getRecvTime(msg));
   }
 }
 
 template <typename T_Point>
-inline void LidarDriverImpl<T_Point>::processMsop()
+inline void LidarDriverImpl<T_Point>::processMsopQueue(const size_t& max_batches)
 {
   if (!difop_flag_ && driver_param_.wait_for_difop)
   {
@@ -407,53 +812,223 @@ inline void LidarDriverImpl<T_Point>::processMsop()
     }
     std::this_thread::sleep_for(std::chrono::milliseconds(10));
     msop_pkt_queue_.clear();
-    msop_pkt_queue_.is_task_finished_.store(true);
     return;
   }
-  while (msop_pkt_queue_.size() > 0)
+  for (size_t n = 0; n < max_batches && msop_pkt_queue_.popBatch(msop_pkt_batch_, MSOP_POP_BATCH_SIZE) > 0; n++)
   {
-    PacketMsg pkt = msop_pkt_queue_.popFront();
-    int height = 1;
-    int ret = lidar_decoder_ptr_->processMsopPkt(pkt.packet.data(), *point_cloud_ptr_, height);
-    scan_ptr_->packets.emplace_back(std::move(pkt));
-    if ((ret == DECODE_OK || ret == FRAME_SPLIT))
+    for (const auto& pkt : msop_pkt_batch_)  ///< const: reading a packet shared with the scan must not copy it
     {
-      if (ret == FRAME_SPLIT)
+      int height = 1;
+      int ret = decodeMsopPkt(pkt, height);
+      scan_ptr_->packets.emplace_back(pkt);
+      if ((ret == DECODE_OK || ret == FRAME_SPLIT))
       {
-        PointCloudMsg<T_Point> msg(point_cloud_transform_func_(point_cloud_ptr_, height));
-        msg.height = height;
-        msg.width = point_cloud_ptr_->size() / msg.height;
-        setPointCloudMsgHeader(msg);
-        if (driver_param_.decoder_param.use_lidar_clock == true)
+        if (ret == FRAME_SPLIT)
         {
-          msg.timestamp = lidar_decoder_ptr_->getLidarTime(pkt.packet.data());
+          double timestamp = driver_param_.decoder_param.use_lidar_clock ?
+                                 lidar_decoder_ptr_->getLidarTime(pkt.packet.data()) :
+                                 getRecvTime(pkt);
+          if (point_cloud_soa_cb_vec_.empty())
+          {
+            publishPointCloud(height, timestamp);
+          }
+          else
+          {
+            publishPointCloudSoA(height, timestamp);
+          }
+          setScanMsgHeader(*scan_ptr_);
+          runCallBack(*scan_ptr_);
+          scan_ptr_->packets.clear();  ///< Callbacks only get a const reference, so the scan can be reused
         }
-        else
-        {
-          msg.timestamp = getTime();
-        }
-        if (msg.point_cloud_ptr->size() == 0)
-        {
-          reportError(Error(ERRCODE_ZEROPOINTS));
-        }
-        else
-        {
-          runCallBack(msg);
-        }
-        setScanMsgHeader(*scan_ptr_);
-        runCallBack(*scan_ptr_);
-        point_cloud_ptr_.reset(new typename PointCloudMsg<T_Point>::PointCloud);
-        scan_ptr_.reset(new ScanMsg);
+      }
+      else
+      {
+        reportError(Error(ERRCODE_WRONGPKTHEADER));
+        msop_pkt_queue_.clear();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        break;
+      }
+    }
+    msop_pkt_batch_.clear();
+  }
+}
+
+template <typename T_Point>
+inline RSDecoderResult LidarDriverImpl<T_Point>::decodeMsopPkt(const PacketMsg& pkt, int& height)
+{
+  const uint8_t* data = pkt.packet.data();
+  lidar_decoder_ptr_->setRecvTime(pkt.packet.timestamp());
+  if (driver_param_.saved_by_rows)
+  {
+    return point_cloud_soa_cb_vec_.empty() ? lidar_decoder_ptr_->processMsopPkt(data, row_major_cloud_, height) :
+                                             lidar_decoder_ptr_->processMsopPkt(data, row_major_soa_cloud_, height);
+  }
+  return point_cloud_soa_cb_vec_.empty() ? lidar_decoder_ptr_->processMsopPkt(data, *point_cloud_ptr_, height) :
+                                           lidar_decoder_ptr_->processMsopPkt(data, *point_cloud_soa_ptr_, height);
+}
+
+template <typename T_Point>
+inline double LidarDriverImpl<T_Point>::getRecvTime(const PacketMsg& pkt)
+{
+  double recv_time = pkt.packet.timestamp();
+  return recv_time > 0 ? recv_time : getTime();
+}
+
+template <typename T_Point>
+inline void LidarDriverImpl<T_Point>::publishPointCloud(const int& height, const double& timestamp)
+{
+  PointCloudMsg<T_Point> msg(point_cloud_ptr_);
+  msg.height = height;
+  msg.width = driver_param_.saved_by_rows ? row_major_cloud_.finish() : point_cloud_ptr_->size() / msg.height;
+  setPointCloudMsgHeader(msg);
+  msg.timestamp = timestamp;
+  if (msg.point_cloud_ptr->size() == 0)
+  {
+    reportError(Error(ERRCODE_ZEROPOINTS));
+  }
+  else
+  {
+    runCallBack(msg);
+  }
+  point_cloud_ptr_ = point_cloud_pool_->allocate(lidar_decoder_ptr_->getMaxPointsPerFrame());
+  if (driver_param_.saved_by_rows)  ///< Expect the next frame to be as wide as this one
+  {
+    row_major_cloud_.reset(*point_cloud_ptr_, height, msg.width,
+                           lidar_decoder_ptr_->getMaxPointsPerFrame() / static_cast<size_t>(height));
+  }
+}
+
+template <typename T_Point>
+inline void LidarDriverImpl<T_Point>::publishPointCloudSoA(const int& height, const double& timestamp)
+{
+  PointCloudSoAMsg msg(point_cloud_soa_ptr_);
+  msg.height = height;
+  msg.width = driver_param_.saved_by_rows ? row_major_soa_cloud_.finish() : point_cloud_soa_ptr_->size() / msg.height;
+  setPointCloudMsgHeader(msg);
+  msg.timestamp = timestamp;
+  if (msg.point_cloud_ptr->size() == 0)
+  {
+    reportError(Error(ERRCODE_ZEROPOINTS));
+  }
+  else
+  {
+    runCallBack(msg);
+    if (!point_cloud_cb_vec_.empty())  ///< Both kinds of callbacks exist, so convert the columns to points
+    {
+      PointCloudMsg<T_Point> point_msg(convertPointCloud(*msg.point_cloud_ptr));
+      point_msg.timestamp = msg.timestamp;
+      point_msg.frame_id = msg.frame_id;
+      point_msg.seq = msg.seq;
+      point_msg.height = msg.height;
+      point_msg.width = msg.width;
+      point_msg.is_dense = msg.is_dense;
+      runCallBack(point_msg);
+    }
+  }
+  point_cloud_soa_ptr_ = point_cloud_soa_pool_->allocate(lidar_decoder_ptr_->getMaxPointsPerFrame());
+  if (driver_param_.saved_by_rows)
+  {
+    row_major_soa_cloud_.reset(*point_cloud_soa_ptr_, height, msg.width,
+                               lidar_decoder_ptr_->getMaxPointsPerFrame() / static_cast<size_t>(height));
+  }
+}
+
+template <typename T_Point>
+inline typename PointCloudMsg<T_Point>::PointCloudPtr
+LidarDriverImpl<T_Point>::convertPointCloud(const PointCloudSoA& cloud)
+{
+  typename PointCloudMsg<T_Point>::PointCloudPtr point_cloud_ptr = point_cloud_pool_->allocate(cloud.size());
+  point_cloud_ptr->resize(cloud.size());
+  for (size_t i = 0; i < cloud.size(); i++)
+  {
+    T_Point& point = (*point_cloud_ptr)[i];
+    setX(point, cloud.x[i]);
+    setY(point, cloud.y[i]);
+    setZ(point, cloud.z[i]);
+    setIntensity(point, cloud.intensity[i]);
+    setRing(point, cloud.ring[i]);
+    setTimestamp(point, cloud.timestamp[i]);
+  }
+  return point_cloud_ptr;
+}
+
+template <typename T_Point>
+inline void LidarDriverImpl<T_Point>::processMsop()
+{
+  do
+  {
+#ifdef __linux__
+    if (reactor_ptr_ != nullptr)  ///< Take turns with the other drivers of the shared pool
+    {
+      processMsopQueue(SHARED_POOL_BATCHES_PER_TASK);
+      if (!msop_pkt_queue_.empty())
+      {
+        commitMsopTask();
+        return;
       }
     }
     else
+#endif
+    {
+      processMsopQueue();
+    }
+    msop_task_scheduled_.store(false);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  } while (!msop_pkt_queue_.empty() && !msop_task_scheduled_.exchange(true));
+}
+
+template <typename T_Point>
+inline void LidarDriverImpl<T_Point>::startDecodeThread()
+{
+  decode_thread_.start_.store(true);
+  decode_thread_.thread_.reset(new std::thread([this]() { decodeThreadLoop(); }));
+  if (driver_param_.decode_thread_cpu >= 0 &&
+      !setThreadAffinity(*decode_thread_.thread_, driver_param_.decode_thread_cpu))
+  {
+    RS_WARNING << "Failed to bind the decode thread to cpu " << driver_param_.decode_thread_cpu << RS_REND;
+  }
+  if (driver_param_.decode_thread_priority > 0 &&
+      !setThreadRealtimePriority(*decode_thread_.thread_, driver_param_.decode_thread_priority))
+  {
+    RS_WARNING << "Failed to set SCHED_FIFO priority " << driver_param_.decode_thread_priority
+               << " of the decode thread" << RS_REND;
+  }
+}
+
+template <typename T_Point>
+inline void LidarDriverImpl<T_Point>::stopDecodeThread()
+{
+  if (decode_thread_.thread_ == nullptr)
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(decode_mutex_);
+    decode_thread_.start_.store(false);
+  }
+  decode_cv_.notify_one();
+  if (decode_thread_.thread_->joinable())
+  {
+    decode_thread_.thread_->join();
+  }
+  decode_thread_.thread_.reset();
+}
+
+template <typename T_Point>
+inline void LidarDriverImpl<T_Point>::decodeThreadLoop()
+{
+  while (decode_thread_.start_.load())
+  {
+    processMsopQueue();
+    std::unique_lock<std::mutex> lock(decode_mutex_);
+    decode_thread_waiting_.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (msop_pkt_queue_.empty() && decode_thread_.start_.load())
     {
-      reportError(Error(ERRCODE_WRONGPKTHEADER));
-      msop_pkt_queue_.clear();
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      decode_cv_.wait_for(lock, std::chrono::milliseconds(100));
     }
+    decode_thread_waiting_.store(false);
   }
-  msop_pkt_queue_.is_task_finished_.store(true);
 }
 
 template <typename T_Point>
@@ -480,11 +1055,10 @@ inline void LidarDriverImpl<T_Point>::processDifop()
 template <typename T_Point>
 inline void LidarDriverImpl<T_Point>::setScanMsgHeader(ScanMsg& msg)
 {
-  msg.timestamp = getTime();
-  if (driver_param_.decoder_param.use_lidar_clock == true)
-  {
-    msg.timestamp = lidar_decoder_ptr_->getLidarTime(msg.packets.back().packet.data());
-  }
+  const PacketMsg& last_pkt = msg.packets.back();  ///< const: the packet is shared, reading it must not copy it
+  msg.timestamp = driver_param_.decoder_param.use_lidar_clock ?
+                      lidar_decoder_ptr_->getLidarTime(last_pkt.packet.data()) :
+                      getRecvTime(last_pkt);
   msg.seq = scan_seq_++;
   msg.frame_id = driver_param_.frame_id;
 }
@@ -497,5 +1071,13 @@ inline void LidarDriverImpl<T_Point>::setPointCloudMsgHeader(PointCloudMsg<T_Poi
   msg.is_dense = false;
 }
 
+template <typename T_Point>
+inline void LidarDriverImpl<T_Point>::setPointCloudMsgHeader(PointCloudSoAMsg& msg)
+{
+  msg.seq = point_cloud_seq_++;
+  msg.frame_id = driver_param_.frame_id;
+  msg.is_dense = false;
+}
+
 }  // namespace lidar
 }  // namespace robosense
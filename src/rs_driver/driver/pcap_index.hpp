@@ -0,0 +1,187 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+#include <rs_driver/driver/pcap_reader.hpp>
+namespace robosense
+{
+namespace lidar
+{
+constexpr char PCAP_INDEX_SUFFIX[] = ".rsidx";   ///< The index of a pcap file is saved next to it
+constexpr char PCAP_INDEX_MAGIC[] = "RSPCAPIX";   ///< 8 bytes
+constexpr uint32_t PCAP_INDEX_VERSION = 1;
+
+struct PcapIndexEntry  ///< Where a frame starts in a pcap file
+{
+  PcapPosition msop;       ///< First msop packet of the frame
+  PcapPosition difop;      ///< Last difop packet before the frame
+  bool has_difop = false;  ///< false if no difop packet comes before the frame
+  double timestamp = 0;    ///< LiDAR time of the first msop packet, unit: s
+};
+
+/**
+ * @brief Frame index of a pcap file, built by one pass over the file and saved as a sidecar file. The key describes
+ * the pcap file and the parameters the frames are split with, an index saved with another key is not loaded.
+ * The sidecar file is in host byte order.
+ */
+class PcapIndex
+{
+public:
+  inline void clear()
+  {
+    frames_.clear();
+    sorted_ = true;
+  }
+
+  inline bool empty() const
+  {
+    return frames_.empty();
+  }
+
+  inline size_t size() const
+  {
+    return frames_.size();
+  }
+
+  inline const PcapIndexEntry& operator[](const size_t& frame) const
+  {
+    return frames_[frame];
+  }
+
+  inline void addFrame(const PcapIndexEntry& entry)
+  {
+    if (!frames_.empty() && entry.timestamp < frames_.back().timestamp)
+    {
+      sorted_ = false;
+    }
+    frames_.emplace_back(entry);
+  }
+
+  /**
+   * @brief Find the frame a LiDAR time falls into, i.e. the last frame starting at or before it. If the LiDAR time
+   * jumps back in the file (e.g. the LiDAR clock was reset), the frames are searched in file order for the first one
+   * the time falls into, from its start to the start of the next frame
+   * @return The frame number, 0 if the time is before the first frame or falls into no frame
+   */
+  inline size_t findFrame(const double& timestamp) const
+  {
+    if (!sorted_)
+    {
+      for (size_t i = 0; i < frames_.size(); i++)
+      {
+        const double& start = frames_[i].timestamp;
+        if (start <= timestamp && (i + 1 == frames_.size() || timestamp < frames_[i + 1].timestamp ||
+                                   frames_[i + 1].timestamp < start))  ///< The last frame before a jump back is open
+        {
+          return i;
+        }
+      }
+      return 0;
+    }
+    auto iter = std::upper_bound(frames_.begin(), frames_.end(), timestamp,
+                                 [](const double& ts, const PcapIndexEntry& entry) { return ts < entry.timestamp; });
+    return (iter == frames_.begin()) ? 0 : static_cast<size_t>(iter - frames_.begin() - 1);
+  }
+
+  inline bool load(const std::string& path, const std::string& key);  ///< false if it has no frames
+  inline bool save(const std::string& path, const std::string& key) const;
+
+private:
+  std::vector<PcapIndexEntry> frames_;
+  bool sorted_ = true;  ///< The frame timestamps never decrease, findFrame() can search by bisection
+};
+
+inline bool PcapIndex::load(const std::string& path, const std::string& key)
+{
+  std::ifstream file(path, std::ios::binary);
+  char magic[8];
+  uint32_t version = 0;
+  uint32_t key_len = 0;
+  if (!file.read(magic, sizeof(magic)) || memcmp(magic, PCAP_INDEX_MAGIC, sizeof(magic)) != 0 ||
+      !file.read(reinterpret_cast<char*>(&version), sizeof(version)) || version != PCAP_INDEX_VERSION ||
+      !file.read(reinterpret_cast<char*>(&key_len), sizeof(key_len)) || key_len != key.size())
+  {
+    return false;
+  }
+  std::string file_key(key_len, '\0');
+  uint64_t frame_num = 0;
+  if (!file.read(&file_key[0], key_len) || file_key != key ||
+      !file.read(reinterpret_cast<char*>(&frame_num), sizeof(frame_num)) || frame_num == 0)
+  {
+    return false;
+  }
+  std::vector<PcapIndexEntry> frames;
+  for (uint64_t i = 0; i < frame_num; i++)  ///< Not sized in advance, frame_num of a broken file may be anything
+  {
+    PcapIndexEntry entry;
+    uint64_t values[5];
+    if (!file.read(reinterpret_cast<char*>(values), sizeof(values)) ||
+        !file.read(reinterpret_cast<char*>(&entry.timestamp), sizeof(entry.timestamp)))
+    {
+      return false;
+    }
+    entry.msop.offset = values[0];
+    entry.msop.section = values[1];
+    entry.difop.offset = values[2];
+    entry.difop.section = values[3];
+    entry.has_difop = (values[4] != 0);
+    frames.emplace_back(entry);
+  }
+  frames_.swap(frames);
+  sorted_ = std::is_sorted(frames_.begin(), frames_.end(), [](const PcapIndexEntry& a, const PcapIndexEntry& b) {
+    return a.timestamp < b.timestamp;
+  });
+  return true;
+}
+
+inline bool PcapIndex::save(const std::string& path, const std::string& key) const
+{
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  uint32_t version = PCAP_INDEX_VERSION;
+  uint32_t key_len = static_cast<uint32_t>(key.size());
+  uint64_t frame_num = frames_.size();
+  file.write(PCAP_INDEX_MAGIC, 8);
+  file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  file.write(reinterpret_cast<const char*>(&key_len), sizeof(key_len));
+  file.write(key.data(), key_len);
+  file.write(reinterpret_cast<const char*>(&frame_num), sizeof(frame_num));
+  for (const auto& entry : frames_)
+  {
+    uint64_t values[5] = { entry.msop.offset, entry.msop.section, entry.difop.offset, entry.difop.section,
+                           entry.has_difop ? 1u : 0u };
+    file.write(reinterpret_cast<const char*>(values), sizeof(values));
+    file.write(reinterpret_cast<const char*>(&entry.timestamp), sizeof(entry.timestamp));
+  }
+  return static_cast<bool>(file.flush());
+}
+}  // namespace lidar
+}  // namespace robosense
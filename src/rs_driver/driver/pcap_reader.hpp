@@ -0,0 +1,702 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+#include <rs_driver/driver/pcap_stream.hpp>
+namespace robosense
+{
+namespace lidar
+{
+constexpr size_t PCAP_READAHEAD_SIZE = 16 * 1024 * 1024;  ///< Bytes of the file prefetched ahead of the read position
+constexpr size_t PCAP_STREAM_LOOKAHEAD = 1024 * 1024;  ///< Decompressed bytes kept ahead of the read position
+constexpr uint32_t PCAP_LINKTYPE_NULL = 0;          ///< BSD loopback, 4 bytes protocol family
+constexpr uint32_t PCAP_LINKTYPE_ETHERNET = 1;
+constexpr uint32_t PCAP_LINKTYPE_RAW = 101;         ///< Raw IPv4 or IPv6
+constexpr uint32_t PCAP_LINKTYPE_LOOP = 108;        ///< OpenBSD loopback, 4 bytes protocol family
+constexpr uint32_t PCAP_LINKTYPE_LINUX_SLL = 113;   ///< Linux cooked capture v1
+constexpr uint32_t PCAP_LINKTYPE_IPV4 = 228;
+constexpr uint32_t PCAP_LINKTYPE_IPV6 = 229;
+constexpr uint32_t PCAP_LINKTYPE_LINUX_SLL2 = 276;  ///< Linux cooked capture v2
+
+struct PcapPacket  ///< One captured packet
+{
+  const uint8_t* data = nullptr;  ///< Captured bytes, starting with the link layer header. No copy of the file data
+  uint32_t caplen = 0;            ///< Number of captured bytes
+  uint32_t link_type = 0;         ///< Link layer header type (LINKTYPE_* of the pcap format)
+  double timestamp = 0;           ///< Capture time, unit: s
+};
+
+struct PcapPosition  ///< Position of a record in a pcap file
+{
+  uint64_t offset = 0;   ///< File offset of the record
+  uint64_t section = 0;  ///< File offset of the header of the section the record belongs to (pcapng only)
+};
+
+/**
+ * @brief Reader of pcap and pcapng files. On Linux the file is memory mapped and read sequentially with readahead.
+ * The packets point into the mapping and stay valid until the reader is closed. Files compressed with gzip, zstd or
+ * lz4 are decompressed by a PcapStream while they are read, and can not be seeked. Elsewhere the packets are read
+ * through libpcap. Packets of compressed files and of libpcap stay valid until the next packet is read.
+ */
+class PcapReader
+{
+public:
+  PcapReader();
+  ~PcapReader();
+  PcapReader(const PcapReader&) = delete;
+  PcapReader& operator=(const PcapReader&) = delete;
+  inline bool open(const std::string& path);
+  inline void close();
+  inline void rewind();  ///< Restart from the first packet
+  inline bool next(PcapPacket& pkt);
+  inline bool failed() const;  ///< Compressed file is corrupt or truncated, next() stopped early. Linux only
+  inline PcapPosition tell() const;            ///< Position of the next packet
+  inline bool seek(const PcapPosition& pos);  ///< Go to a position got from tell(). Linux only
+  inline bool seekable() const;
+  inline uint64_t fileSize() const;
+  inline double progress() const;  ///< Part of the file read, from 0 to 1
+  inline int64_t fileTime() const;  ///< Last modification time, unit: s. Linux only
+
+private:
+#ifdef __linux__
+  struct PcapngInterface
+  {
+    uint32_t link_type;
+    uint64_t ts_per_sec;  ///< Timestamp units per second
+    int64_t ts_offset;    ///< unit: s
+  };
+  inline bool nextPcap(PcapPacket& pkt);
+  inline bool nextPcapng(PcapPacket& pkt);
+  inline bool readSectionHeader();
+  inline void readInterface(const uint8_t* blk, const uint32_t& blk_len);
+  inline void setTimestamp(PcapPacket& pkt, const uint32_t& if_id, const uint32_t& ts_high, const uint32_t& ts_low);
+  inline void readahead();
+  inline void prefetch();
+  inline void refill();
+  inline uint16_t read16(const uint8_t* p) const;
+  inline uint32_t read32(const uint8_t* p) const;
+  inline uint64_t read64(const uint8_t* p) const;
+
+private:
+  const uint8_t* map_;      ///< The mapped file, or the window of the decompressed data
+  int fd_;                  ///< The mapped file, kept open to drop its page cache
+  size_t size_;
+  size_t offset_;           ///< Read position
+  uint64_t base_offset_;    ///< Offset of map_ in the (decompressed) file
+  uint64_t file_size_;
+  size_t first_offset_;     ///< Position of the first record
+  size_t section_offset_;   ///< Position of the current section header
+  size_t prefetch_offset_;  ///< End of the prefetched range
+  size_t release_offset_;   ///< End of the range already read and released
+  bool pcapng_;
+  bool swapped_;  ///< Byte order of the file (section) differs from the host
+  int64_t mtime_;
+  uint32_t link_type_;
+  double ts_unit_;  ///< unit: s, pcap only
+  std::vector<PcapngInterface> interfaces_;
+  double last_timestamp_;
+  std::string path_;
+  std::unique_ptr<PcapStream> stream_;  ///< Set for compressed files
+  std::vector<uint8_t> stream_buf_;
+#else
+  pcap_t* pcap_;
+  std::string path_;
+#endif
+};
+
+#ifdef __linux__
+constexpr uint32_t PCAP_MAGIC_USEC = 0xA1B2C3D4;
+constexpr uint32_t PCAP_MAGIC_NSEC = 0xA1B23C4D;
+constexpr uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+constexpr uint32_t PCAPNG_SECTION_HEADER_BLOCK = 0x0A0D0D0A;
+constexpr uint32_t PCAPNG_INTERFACE_BLOCK = 1;
+constexpr uint32_t PCAPNG_PACKET_BLOCK = 2;  ///< Obsolete, but still written by old tools
+constexpr uint32_t PCAPNG_SIMPLE_PACKET_BLOCK = 3;
+constexpr uint32_t PCAPNG_ENHANCED_PACKET_BLOCK = 6;
+
+inline PcapReader::PcapReader()
+  : map_(nullptr)
+  , fd_(-1)
+  , size_(0)
+  , offset_(0)
+  , base_offset_(0)
+  , file_size_(0)
+  , first_offset_(0)
+  , section_offset_(0)
+  , prefetch_offset_(0)
+  , release_offset_(0)
+  , pcapng_(false)
+  , swapped_(false)
+  , mtime_(0)
+  , link_type_(0)
+  , ts_unit_(1e-6)
+  , last_timestamp_(0)
+{
+}
+
+inline PcapReader::~PcapReader()
+{
+  close();
+}
+
+inline bool PcapReader::open(const std::string& path)
+{
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+  struct stat st;
+  uint8_t file_magic[4];
+  if (fstat(fd, &st) != 0 || st.st_size < 24 || pread(fd, file_magic, sizeof(file_magic), 0) != sizeof(file_magic))
+  {
+    ::close(fd);
+    return false;
+  }
+  path_ = path;
+  file_size_ = static_cast<uint64_t>(st.st_size);
+  mtime_ = static_cast<int64_t>(st.st_mtime);
+  PcapCompression compression = PcapStream::detect(file_magic);
+  if (compression != PCAP_UNCOMPRESSED)
+  {
+    ::close(fd);
+    stream_.reset(new PcapStream());
+    if (!stream_->open(path, compression))
+    {
+      close();
+      return false;
+    }
+    refill();
+    if (size_ < 24)
+    {
+      close();
+      return false;
+    }
+  }
+  else
+  {
+    void* map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+    {
+      ::close(fd);
+      return false;
+    }
+    fd_ = fd;
+    map_ = static_cast<const uint8_t*>(map);
+    size_ = static_cast<size_t>(st.st_size);
+    madvise(map, size_, MADV_SEQUENTIAL);
+  }
+
+  uint32_t magic;
+  memcpy(&magic, map_, sizeof(magic));
+  if (magic == PCAPNG_SECTION_HEADER_BLOCK)
+  {
+    pcapng_ = true;
+    offset_ = 0;
+    if (!readSectionHeader())
+    {
+      close();
+      return false;
+    }
+  }
+  else
+  {
+    swapped_ = (magic == __builtin_bswap32(PCAP_MAGIC_USEC) || magic == __builtin_bswap32(PCAP_MAGIC_NSEC));
+    magic = read32(map_);
+    if (magic != PCAP_MAGIC_USEC && magic != PCAP_MAGIC_NSEC)
+    {
+      close();
+      return false;
+    }
+    pcapng_ = false;
+    ts_unit_ = (magic == PCAP_MAGIC_NSEC) ? 1e-9 : 1e-6;
+    link_type_ = read32(map_ + 20) & 0xFFFF;
+    offset_ = 24;
+  }
+  first_offset_ = pcapng_ ? 0 : offset_;  ///< The section header of pcapng is read again on rewind
+  if (stream_ == nullptr)
+  {
+    prefetch();
+  }
+  return true;
+}
+
+inline void PcapReader::close()
+{
+  if (stream_ != nullptr)
+  {
+    stream_.reset();
+    std::vector<uint8_t>().swap(stream_buf_);
+  }
+  else if (map_ != nullptr)
+  {
+    munmap(const_cast<uint8_t*>(map_), size_);
+  }
+  if (fd_ >= 0)
+  {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  map_ = nullptr;
+  size_ = offset_ = first_offset_ = section_offset_ = prefetch_offset_ = release_offset_ = 0;
+  base_offset_ = file_size_ = 0;
+  mtime_ = 0;
+  interfaces_.clear();
+  last_timestamp_ = 0;
+}
+
+inline void PcapReader::rewind()
+{
+  if (map_ == nullptr)
+  {
+    return;
+  }
+  if (stream_ != nullptr)  ///< Decompress again from the start
+  {
+    std::string path = path_;
+    open(path);
+    return;
+  }
+  offset_ = first_offset_;
+  prefetch_offset_ = release_offset_ = 0;
+  interfaces_.clear();
+  prefetch();
+}
+
+inline bool PcapReader::failed() const
+{
+  return stream_ != nullptr && stream_->failed();
+}
+
+inline PcapPosition PcapReader::tell() const
+{
+  PcapPosition pos;
+  pos.offset = base_offset_ + offset_;
+  pos.section = section_offset_;
+  return pos;
+}
+
+inline bool PcapReader::seek(const PcapPosition& pos)
+{
+  if (!seekable() || pos.offset > size_ || pos.section > pos.offset)
+  {
+    return false;
+  }
+  if (pcapng_)
+  {
+    ///< Read the section header again, and the interfaces described right after it
+    offset_ = static_cast<size_t>(pos.section);
+    if (!readSectionHeader())
+    {
+      return false;
+    }
+    while (size_ - offset_ >= 12 && read32(map_ + offset_) == PCAPNG_INTERFACE_BLOCK)
+    {
+      uint32_t blk_len = read32(map_ + offset_ + 4);
+      if (blk_len < 12 || blk_len > size_ - offset_)
+      {
+        return false;
+      }
+      readInterface(map_ + offset_, blk_len);
+      offset_ += blk_len;
+    }
+  }
+  offset_ = std::max(offset_, std::max(first_offset_, static_cast<size_t>(pos.offset)));
+  prefetch_offset_ = release_offset_ = offset_ / PCAP_READAHEAD_SIZE * PCAP_READAHEAD_SIZE;
+  prefetch();
+  return true;
+}
+
+inline bool PcapReader::seekable() const
+{
+  return map_ != nullptr && stream_ == nullptr;
+}
+
+inline uint64_t PcapReader::fileSize() const
+{
+  return file_size_;
+}
+
+inline double PcapReader::progress() const
+{
+  if (file_size_ == 0)
+  {
+    return 0;
+  }
+  uint64_t read_bytes = (stream_ != nullptr) ? stream_->bytesRead() : offset_;
+  return std::min(1.0, static_cast<double>(read_bytes) / file_size_);
+}
+
+inline int64_t PcapReader::fileTime() const
+{
+  return mtime_;
+}
+
+inline bool PcapReader::next(PcapPacket& pkt)
+{
+  if (map_ == nullptr)
+  {
+    return false;
+  }
+  readahead();
+  return pcapng_ ? nextPcapng(pkt) : nextPcap(pkt);
+}
+
+inline bool PcapReader::nextPcap(PcapPacket& pkt)
+{
+  const uint32_t REC_HDR_LEN = 16;
+  if (size_ - offset_ < REC_HDR_LEN)
+  {
+    return false;
+  }
+  const uint8_t* rec = map_ + offset_;
+  uint32_t caplen = read32(rec + 8);
+  if (caplen > size_ - offset_ - REC_HDR_LEN)  ///< Truncated file
+  {
+    return false;
+  }
+  pkt.data = rec + REC_HDR_LEN;
+  pkt.caplen = caplen;
+  pkt.link_type = link_type_;
+  pkt.timestamp = read32(rec) + read32(rec + 4) * ts_unit_;
+  offset_ += REC_HDR_LEN + caplen;
+  return true;
+}
+
+inline bool PcapReader::nextPcapng(PcapPacket& pkt)
+{
+  while (true)
+  {
+    readahead();  ///< Blocks other than packets are skipped in this loop
+    if (size_ - offset_ < 12)
+    {
+      return false;
+    }
+    const uint8_t* blk = map_ + offset_;
+    uint32_t blk_type = read32(blk);
+    if (blk_type == PCAPNG_SECTION_HEADER_BLOCK)
+    {
+      if (!readSectionHeader())
+      {
+        return false;
+      }
+      continue;
+    }
+    uint32_t blk_len = read32(blk + 4);
+    if (blk_len < 12 || blk_len > size_ - offset_)
+    {
+      return false;
+    }
+    offset_ += blk_len;
+    switch (blk_type)
+    {
+      case PCAPNG_INTERFACE_BLOCK:
+        readInterface(blk, blk_len);
+        break;
+      case PCAPNG_ENHANCED_PACKET_BLOCK:
+      case PCAPNG_PACKET_BLOCK:
+      {
+        if (blk_len < 32)
+        {
+          break;
+        }
+        uint32_t if_id = (blk_type == PCAPNG_PACKET_BLOCK) ? read16(blk + 8) : read32(blk + 8);
+        uint32_t caplen = read32(blk + 20);
+        if (if_id >= interfaces_.size() || caplen > blk_len - 32)
+        {
+          break;
+        }
+        pkt.data = blk + 28;
+        pkt.caplen = caplen;
+        pkt.link_type = interfaces_[if_id].link_type;
+        setTimestamp(pkt, if_id, read32(blk + 12), read32(blk + 16));
+        return true;
+      }
+      case PCAPNG_SIMPLE_PACKET_BLOCK:  ///< No timestamp, the packet gets the one of the previous packet
+        if (blk_len < 16 || interfaces_.empty())
+        {
+          break;
+        }
+        pkt.data = blk + 12;
+        pkt.caplen = std::min(read32(blk + 8), blk_len - 16);
+        pkt.link_type = interfaces_[0].link_type;
+        pkt.timestamp = last_timestamp_;
+        return true;
+      default:
+        break;
+    }
+  }
+}
+
+inline bool PcapReader::readSectionHeader()
+{
+  if (size_ - offset_ < 28)
+  {
+    return false;
+  }
+  const uint8_t* blk = map_ + offset_;
+  uint32_t byte_order;
+  memcpy(&byte_order, blk + 8, sizeof(byte_order));
+  if (byte_order != PCAPNG_BYTE_ORDER_MAGIC && byte_order != __builtin_bswap32(PCAPNG_BYTE_ORDER_MAGIC))
+  {
+    return false;
+  }
+  swapped_ = (byte_order != PCAPNG_BYTE_ORDER_MAGIC);
+  uint32_t blk_len = read32(blk + 4);
+  if (blk_len < 28 || blk_len > size_ - offset_)
+  {
+    return false;
+  }
+  interfaces_.clear();  ///< Interface ids are local to a section
+  section_offset_ = base_offset_ + offset_;
+  offset_ += blk_len;
+  return true;
+}
+
+inline void PcapReader::readInterface(const uint8_t* blk, const uint32_t& blk_len)
+{
+  if (blk_len < 20)
+  {
+    return;
+  }
+  PcapngInterface iface;
+  iface.link_type = read16(blk + 8);
+  iface.ts_per_sec = 1000000;
+  iface.ts_offset = 0;
+  const uint8_t* opt = blk + 16;
+  const uint8_t* opt_end = blk + blk_len - 4;
+  while (opt_end - opt >= 4)
+  {
+    uint16_t code = read16(opt);
+    uint16_t len = read16(opt + 2);
+    if (code == 0 || opt_end - opt - 4 < len)
+    {
+      break;
+    }
+    if (code == 9 && len == 1)  ///< if_tsresol
+    {
+      uint8_t resol = opt[4];
+      uint32_t exp = resol & 0x7F;
+      if (exp < 20 || ((resol & 0x80) && exp < 64))
+      {
+        iface.ts_per_sec = 1;
+        for (uint32_t i = 0; i < exp; i++)
+        {
+          iface.ts_per_sec *= (resol & 0x80) ? 2 : 10;
+        }
+      }
+    }
+    else if (code == 14 && len == 8)  ///< if_tsoffset
+    {
+      iface.ts_offset = static_cast<int64_t>(read64(opt + 4));
+    }
+    opt += 4 + ((len + 3) & ~3);
+  }
+  interfaces_.emplace_back(iface);
+}
+
+inline void PcapReader::setTimestamp(PcapPacket& pkt, const uint32_t& if_id, const uint32_t& ts_high,
+                                     const uint32_t& ts_low)
+{
+  const PcapngInterface& iface = interfaces_[if_id];
+  uint64_t ts = (static_cast<uint64_t>(ts_high) << 32) | ts_low;
+  pkt.timestamp = static_cast<double>(ts / iface.ts_per_sec + iface.ts_offset) +
+                  static_cast<double>(ts % iface.ts_per_sec) / iface.ts_per_sec;
+  last_timestamp_ = pkt.timestamp;
+}
+
+inline void PcapReader::readahead()
+{
+  if (stream_ != nullptr)
+  {
+    if (size_ - offset_ < PCAP_STREAM_LOOKAHEAD)
+    {
+      refill();
+    }
+  }
+  else if (offset_ + PCAP_READAHEAD_SIZE > prefetch_offset_)
+  {
+    prefetch();
+  }
+}
+
+inline void PcapReader::prefetch()
+{
+  while (offset_ + PCAP_READAHEAD_SIZE > prefetch_offset_ && prefetch_offset_ < size_)
+  {
+    size_t len = std::min(PCAP_READAHEAD_SIZE, size_ - prefetch_offset_);
+    madvise(const_cast<uint8_t*>(map_) + prefetch_offset_, len, MADV_WILLNEED);
+    prefetch_offset_ += len;
+  }
+  ///< Drop the pages already read, so that replaying a large file does not fill the memory with its page cache.
+  ///< madvise() only unmaps them, which lowers the RSS. The cache itself is dropped by posix_fadvise(), which skips
+  ///< pages that are still mapped. Packets handed out before stay readable, their pages are just read again.
+  size_t release_end = offset_ / PCAP_READAHEAD_SIZE * PCAP_READAHEAD_SIZE;
+  if (release_end > release_offset_)
+  {
+    madvise(const_cast<uint8_t*>(map_) + release_offset_, release_end - release_offset_, MADV_DONTNEED);
+    posix_fadvise(fd_, static_cast<off_t>(release_offset_), static_cast<off_t>(release_end - release_offset_),
+                  POSIX_FADV_DONTNEED);
+    release_offset_ = release_end;
+  }
+}
+
+/**
+ * @brief Move the bytes not read yet to the front of the window, and append decompressed blocks behind them. A record
+ * is never split as long as it is shorter than PCAP_STREAM_LOOKAHEAD
+ */
+inline void PcapReader::refill()
+{
+  if (offset_ > 0)
+  {
+    memmove(stream_buf_.data(), stream_buf_.data() + offset_, size_ - offset_);
+    base_offset_ += offset_;
+    size_ -= offset_;
+    offset_ = 0;
+  }
+  stream_buf_.resize(size_);
+  while (stream_buf_.size() < PCAP_STREAM_LOOKAHEAD && stream_->read(stream_buf_))
+  {
+  }
+  map_ = stream_buf_.data();
+  size_ = stream_buf_.size();
+}
+
+inline uint16_t PcapReader::read16(const uint8_t* p) const
+{
+  uint16_t v;
+  memcpy(&v, p, sizeof(v));
+  return swapped_ ? __builtin_bswap16(v) : v;
+}
+
+inline uint32_t PcapReader::read32(const uint8_t* p) const
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return swapped_ ? __builtin_bswap32(v) : v;
+}
+
+inline uint64_t PcapReader::read64(const uint8_t* p) const
+{
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return swapped_ ? __builtin_bswap64(v) : v;
+}
+#else
+inline PcapReader::PcapReader() : pcap_(nullptr)
+{
+}
+
+inline PcapReader::~PcapReader()
+{
+  close();
+}
+
+inline bool PcapReader::open(const std::string& path)
+{
+  close();
+  char errbuf[PCAP_ERRBUF_SIZE];
+  pcap_ = pcap_open_offline(path.c_str(), errbuf);
+  path_ = path;
+  return pcap_ != nullptr;
+}
+
+inline void PcapReader::close()
+{
+  if (pcap_ != nullptr)
+  {
+    pcap_close(pcap_);
+    pcap_ = nullptr;
+  }
+}
+
+inline void PcapReader::rewind()
+{
+  if (pcap_ != nullptr)
+  {
+    open(path_);
+  }
+}
+
+inline bool PcapReader::failed() const
+{
+  return false;
+}
+
+inline PcapPosition PcapReader::tell() const
+{
+  return PcapPosition();
+}
+
+inline bool PcapReader::seek(const PcapPosition&)
+{
+  return false;
+}
+
+inline bool PcapReader::seekable() const
+{
+  return false;
+}
+
+inline uint64_t PcapReader::fileSize() const
+{
+  return 0;
+}
+
+inline double PcapReader::progress() const
+{
+  return 0;
+}
+
+inline int64_t PcapReader::fileTime() const
+{
+  return 0;
+}
+
+inline bool PcapReader::next(PcapPacket& pkt)
+{
+  struct pcap_pkthdr* header;
+  const u_char* data;
+  if (pcap_ == nullptr || pcap_next_ex(pcap_, &header, &data) != 1)
+  {
+    return false;
+  }
+  pkt.data = data;
+  pkt.caplen = header->caplen;
+  pkt.link_type = static_cast<uint32_t>(pcap_datalink(pcap_));
+  pkt.timestamp = header->ts.tv_sec + header->ts.tv_usec * 1e-6;
+  return true;
+}
+#endif
+}  // namespace lidar
+}  // namespace robosense
@@ -0,0 +1,430 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+#include <rs_driver/common/common_header.h>
+#ifdef ENABLE_PCAP_GZIP
+#include <zlib.h>
+#endif
+#ifdef ENABLE_PCAP_ZSTD
+#include <zstd.h>
+#endif
+#ifdef ENABLE_PCAP_LZ4
+#include <lz4frame.h>
+#endif
+namespace robosense
+{
+namespace lidar
+{
+constexpr size_t PCAP_STREAM_READ_SIZE = 1024 * 1024;       ///< Compressed bytes read from the file at a time
+constexpr size_t PCAP_STREAM_BLOCK_SIZE = 4 * 1024 * 1024;  ///< Decompressed bytes handed to the reader at a time
+
+enum PcapCompression
+{
+  PCAP_UNCOMPRESSED = 0,
+  PCAP_GZIP,
+  PCAP_ZSTD,
+  PCAP_LZ4
+};
+
+/**
+ * @brief Streaming decompressor of one format
+ */
+class PcapDecompressor
+{
+public:
+  virtual ~PcapDecompressor() = default;
+
+  /**
+   * @brief Decompress as much of in as fits into out. Called with in_len 0 at the end of the file, to flush
+   * @param in_used Number of bytes of in consumed
+   * @param out_used Number of bytes written to out
+   * @return false if the data is corrupt. out_used still counts the bytes decompressed before the corrupt data
+   */
+  virtual bool decompress(const uint8_t* in, const size_t& in_len, size_t& in_used, uint8_t* out,
+                          const size_t& out_len, size_t& out_used) = 0;
+
+  /**
+   * @brief Whether the data so far ends with a complete frame (gzip member). If not at the end of the file, the
+   * file is truncated
+   */
+  bool finished() const
+  {
+    return finished_;
+  }
+
+protected:
+  /* Called by decompress(): a frame ended, or more of the data was used */
+  void updateFinished(const bool& frame_end, const size_t& in_used, const size_t& out_used)
+  {
+    if (frame_end)
+    {
+      finished_ = true;
+    }
+    else if (in_used > 0 || out_used > 0)
+    {
+      finished_ = false;
+    }
+  }
+
+private:
+  bool finished_ = false;
+};
+
+#ifdef ENABLE_PCAP_GZIP
+class GzipDecompressor : public PcapDecompressor
+{
+public:
+  GzipDecompressor()
+  {
+    memset(&strm_, 0, sizeof(strm_));
+    inflateInit2(&strm_, 15 + 32);  ///< Detect the gzip or zlib header
+  }
+
+  ~GzipDecompressor()
+  {
+    inflateEnd(&strm_);
+  }
+
+  bool decompress(const uint8_t* in, const size_t& in_len, size_t& in_used, uint8_t* out, const size_t& out_len,
+                  size_t& out_used) override
+  {
+    strm_.next_in = const_cast<Bytef*>(in);
+    strm_.avail_in = static_cast<uInt>(in_len);
+    strm_.next_out = out;
+    strm_.avail_out = static_cast<uInt>(out_len);
+    int ret = inflate(&strm_, Z_NO_FLUSH);
+    in_used = in_len - strm_.avail_in;
+    out_used = out_len - strm_.avail_out;
+    if (ret == Z_STREAM_END)
+    {
+      inflateReset(&strm_);  ///< Files of several gzip members, as written by pigz or by concatenating files
+    }
+    else if (ret != Z_OK && ret != Z_BUF_ERROR)
+    {
+      return false;
+    }
+    updateFinished(ret == Z_STREAM_END, in_used, out_used);
+    return true;
+  }
+
+private:
+  z_stream strm_;
+};
+#endif
+
+#ifdef ENABLE_PCAP_ZSTD
+class ZstdDecompressor : public PcapDecompressor
+{
+public:
+  ZstdDecompressor() : dstream_(ZSTD_createDStream())
+  {
+    ZSTD_initDStream(dstream_);
+  }
+
+  ~ZstdDecompressor()
+  {
+    ZSTD_freeDStream(dstream_);
+  }
+
+  bool decompress(const uint8_t* in, const size_t& in_len, size_t& in_used, uint8_t* out, const size_t& out_len,
+                  size_t& out_used) override
+  {
+    ZSTD_inBuffer in_buf = { in, in_len, 0 };
+    ZSTD_outBuffer out_buf = { out, out_len, 0 };
+    size_t ret = ZSTD_decompressStream(dstream_, &out_buf, &in_buf);
+    in_used = in_buf.pos;
+    out_used = out_buf.pos;
+    if (ZSTD_isError(ret))
+    {
+      return false;
+    }
+    updateFinished(ret == 0, in_used, out_used);  ///< 0: a frame is decoded and flushed
+    return true;
+  }
+
+private:
+  ZSTD_DStream* dstream_;
+};
+#endif
+
+#ifdef ENABLE_PCAP_LZ4
+class Lz4Decompressor : public PcapDecompressor
+{
+public:
+  Lz4Decompressor() : ctx_(nullptr)
+  {
+    LZ4F_createDecompressionContext(&ctx_, LZ4F_VERSION);
+  }
+
+  ~Lz4Decompressor()
+  {
+    LZ4F_freeDecompressionContext(ctx_);
+  }
+
+  bool decompress(const uint8_t* in, const size_t& in_len, size_t& in_used, uint8_t* out, const size_t& out_len,
+                  size_t& out_used) override
+  {
+    in_used = in_len;
+    out_used = out_len;
+    size_t ret = LZ4F_decompress(ctx_, out, &out_used, in, &in_used, nullptr);
+    if (LZ4F_isError(ret))
+    {
+      out_used = 0;
+      return false;
+    }
+    updateFinished(ret == 0, in_used, out_used);  ///< 0: a frame is decoded and flushed
+    return true;
+  }
+
+private:
+  LZ4F_dctx* ctx_;
+};
+#endif
+
+/**
+ * @brief Decompress a file on a thread of its own. The decompressed data is handed over in blocks through a double
+ * buffer, so that one block is decompressed while the reader parses the previous one
+ */
+class PcapStream
+{
+public:
+  PcapStream();
+  ~PcapStream();
+  PcapStream(const PcapStream&) = delete;
+  PcapStream& operator=(const PcapStream&) = delete;
+  static inline PcapCompression detect(const uint8_t* magic);  ///< Format of a file by its first 4 bytes
+  inline bool open(const std::string& path, const PcapCompression& compression);
+  inline void close();
+  inline bool read(std::vector<uint8_t>& buf);  ///< Append the next block to buf, false at the end of the file
+  inline bool failed();                         ///< The file is corrupt or truncated, and ended early
+  inline uint64_t bytesRead() const;            ///< Compressed bytes read from the file so far
+
+private:
+  inline void decompressLoop();
+
+private:
+  FILE* file_;
+  std::unique_ptr<PcapDecompressor> decompressor_;
+  std::thread thread_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::vector<uint8_t> blocks_[2];
+  bool full_[2];      ///< The block is decompressed and not handed over yet
+  size_t read_idx_;   ///< Block handed over next
+  bool end_;          ///< No more blocks will be filled
+  bool error_;        ///< Ended by corrupt or truncated data
+  bool stop_flag_;
+  std::atomic<uint64_t> bytes_read_;
+};
+
+inline PcapStream::PcapStream()
+  : file_(nullptr), read_idx_(0), end_(true), error_(false), stop_flag_(false), bytes_read_(0)
+{
+  full_[0] = full_[1] = false;
+}
+
+inline PcapStream::~PcapStream()
+{
+  close();
+}
+
+inline PcapCompression PcapStream::detect(const uint8_t* magic)
+{
+  if (magic[0] == 0x1F && magic[1] == 0x8B)
+  {
+    return PCAP_GZIP;
+  }
+  if (magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD)
+  {
+    return PCAP_ZSTD;
+  }
+  if (magic[0] == 0x04 && magic[1] == 0x22 && magic[2] == 0x4D && magic[3] == 0x18)
+  {
+    return PCAP_LZ4;
+  }
+  return PCAP_UNCOMPRESSED;
+}
+
+inline bool PcapStream::open(const std::string& path, const PcapCompression& compression)
+{
+  close();
+  switch (compression)
+  {
+#ifdef ENABLE_PCAP_GZIP
+    case PCAP_GZIP:
+      decompressor_.reset(new GzipDecompressor());
+      break;
+#endif
+#ifdef ENABLE_PCAP_ZSTD
+    case PCAP_ZSTD:
+      decompressor_.reset(new ZstdDecompressor());
+      break;
+#endif
+#ifdef ENABLE_PCAP_LZ4
+    case PCAP_LZ4:
+      decompressor_.reset(new Lz4Decompressor());
+      break;
+#endif
+    default:
+      RS_ERROR << path << " is compressed in a format the driver is not built for, see ENABLE_PCAP_COMPRESSION"
+               << RS_REND;
+      return false;
+  }
+  file_ = fopen(path.c_str(), "rb");
+  if (file_ == nullptr)
+  {
+    decompressor_.reset();
+    return false;
+  }
+  full_[0] = full_[1] = false;
+  read_idx_ = 0;
+  end_ = false;
+  error_ = false;
+  stop_flag_ = false;
+  bytes_read_ = 0;
+  thread_ = std::thread(&PcapStream::decompressLoop, this);
+  return true;
+}
+
+inline void PcapStream::close()
+{
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_flag_ = true;
+  }
+  cv_.notify_all();
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+  if (file_ != nullptr)
+  {
+    fclose(file_);
+    file_ = nullptr;
+  }
+  decompressor_.reset();
+  end_ = true;
+}
+
+inline bool PcapStream::read(std::vector<uint8_t>& buf)
+{
+  std::unique_lock<std::mutex> lock(mtx_);
+  cv_.wait(lock, [this] { return full_[read_idx_] || end_ || stop_flag_; });
+  if (!full_[read_idx_])
+  {
+    return false;
+  }
+  const std::vector<uint8_t>& block = blocks_[read_idx_];
+  buf.insert(buf.end(), block.begin(), block.end());
+  full_[read_idx_] = false;
+  read_idx_ ^= 1;
+  cv_.notify_all();
+  return true;
+}
+
+inline bool PcapStream::failed()
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  return error_;
+}
+
+inline uint64_t PcapStream::bytesRead() const
+{
+  return bytes_read_.load();
+}
+
+inline void PcapStream::decompressLoop()
+{
+  std::vector<uint8_t> in(PCAP_STREAM_READ_SIZE);
+  size_t in_pos = 0;
+  size_t in_len = 0;
+  bool file_end = false;
+  bool stream_end = false;
+  bool error = false;
+  size_t write_idx = 0;
+  while (!stream_end)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mtx_);
+      cv_.wait(lock, [&] { return !full_[write_idx] || stop_flag_; });
+      if (stop_flag_)
+      {
+        return;
+      }
+    }
+    std::vector<uint8_t>& block = blocks_[write_idx];
+    block.resize(PCAP_STREAM_BLOCK_SIZE);
+    size_t out_len = 0;
+    while (out_len < block.size())
+    {
+      if (in_pos == in_len && !file_end)
+      {
+        in_pos = 0;
+        in_len = fread(in.data(), 1, in.size(), file_);
+        file_end = (in_len == 0);
+        bytes_read_ += in_len;
+      }
+      size_t in_used = 0;
+      size_t out_used = 0;
+      if (!decompressor_->decompress(in.data() + in_pos, in_len - in_pos, in_used, block.data() + out_len,
+                                     block.size() - out_len, out_used))
+      {
+        error = true;  ///< Corrupt data
+        out_len += out_used;
+      }
+      else if (in_used == 0 && out_used == 0)  ///< Everything decompressed and flushed, or stuck
+      {
+        error = (in_pos < in_len) || !file_end || !decompressor_->finished();
+      }
+      if (error || (in_used == 0 && out_used == 0))
+      {
+        stream_end = true;
+        break;
+      }
+      in_pos += in_used;
+      out_len += out_used;
+    }
+    block.resize(out_len);
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (out_len > 0)
+    {
+      full_[write_idx] = true;
+      write_idx ^= 1;
+    }
+    end_ = stream_end;
+    error_ = error;
+    cv_.notify_all();
+  }
+}
+}  // namespace lidar
+}  // namespace robosense
@@ -0,0 +1,492 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+#include <rs_driver/common/error_code.h>
+#include <rs_driver/driver/driver_param.h>
+#include <rs_driver/driver/pcap_reader.hpp>
+#include <rs_driver/msg/packet_msg.h>
+namespace robosense
+{
+namespace lidar
+{
+constexpr size_t PCAP_WRITE_ALIGN = 4096;          ///< Alignment of addresses and lengths written with O_DIRECT
+constexpr uint32_t PCAP_WRITE_MAGIC = 0xA1B23C4D;  ///< Nanosecond timestamps
+constexpr size_t PCAP_FILE_HDR_LEN = 24;
+constexpr size_t PCAP_REC_HDR_LEN = 16;
+constexpr size_t PCAP_UDP_HDRS_LEN = 42;           ///< Ethernet, IPv4 and UDP headers put in front of every packet
+constexpr uint32_t PCAP_FLUSH_INTERVAL_MS = 1000;  ///< Longest time a recorded packet waits in memory
+constexpr uint32_t PCAP_MAX_FILE_TRIES = 10000;    ///< Taken file names skipped before the recording fails
+
+/**
+ * @brief Recorder of received packets to pcap files. The input threads append records to one of two buffers, while
+ * the thread of the writer writes the other one to the file, so recording never waits for the disk. When both
+ * buffers are full, packets are dropped and ERRCODE_RECORDOVERFLOW is reported.
+ * The packets are wrapped in Ethernet/IPv4/UDP headers, sent from the LiDAR address to the broadcast address.
+ * Existing files are never overwritten, e.g. by a restart: the next free numbered name is used instead.
+ */
+class PcapWriter
+{
+public:
+  PcapWriter(const RSRecorderParam& param, const std::string& device_ip,
+             const std::function<void(const Error&)>& excb);
+  ~PcapWriter();
+  PcapWriter(const PcapWriter&) = delete;
+  PcapWriter& operator=(const PcapWriter&) = delete;
+  inline bool start();
+  inline void stop();  ///< Write all recorded packets and close the file
+  inline void record(const PacketMsg& msg, const uint16_t& port, const double& timestamp);
+
+private:
+  inline void writeLoop();
+  inline void swapBuffers(const bool& rotate);
+  inline void putFileHeader(uint8_t* buf);
+  inline std::string filePath(const uint32_t& index) const;
+  inline bool openFile();
+  inline bool createFile(const std::string& path, bool& direct);
+  inline bool writeFile(const uint8_t* data, const size_t& len);
+  inline void closeFile();
+
+private:
+  RSRecorderParam param_;
+  std::function<void(const Error&)> excb_;
+  uint8_t udp_hdrs_[PCAP_UDP_HDRS_LEN];
+  size_t capacity_;
+  std::vector<uint8_t> storage_[2];
+  uint8_t* buffers_[2];     ///< First aligned bytes of storage_
+  size_t active_;           ///< Buffer the packets are appended to
+  size_t active_len_;
+  size_t write_idx_;        ///< Buffer handed to the writing thread
+  size_t write_len_;
+  bool close_after_write_;  ///< The handed buffer is the last one of its file
+  bool writing_;
+  bool running_;
+  bool stop_flag_;
+  size_t align_;            ///< Length unit of the writes, PCAP_WRITE_ALIGN with O_DIRECT
+  uint64_t max_file_bytes_;
+  uint64_t file_bytes_;     ///< Bytes of the current file handed to the writing thread
+  uint32_t file_index_;     ///< Number of the next numbered file, kept across restarts
+  std::chrono::steady_clock::time_point file_open_time_;
+  std::chrono::steady_clock::time_point swap_time_;
+  uint64_t dropped_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::thread thread_;
+#ifdef __linux__
+  int fd_;
+#else
+  FILE* file_;
+#endif
+};
+
+inline PcapWriter::PcapWriter(const RSRecorderParam& param, const std::string& device_ip,
+                              const std::function<void(const Error&)>& excb)
+  : param_(param)
+  , excb_(excb)
+  , capacity_(std::max<size_t>(1, param.buffer_size) * 1024 * 1024)
+  , active_(0)
+  , active_len_(0)
+  , write_idx_(1)
+  , write_len_(0)
+  , close_after_write_(false)
+  , writing_(false)
+  , running_(false)
+  , stop_flag_(false)
+  , align_(1)
+  , max_file_bytes_(static_cast<uint64_t>(param.max_file_size) * 1024 * 1024)
+  , file_bytes_(0)
+  , file_index_(0)
+  , dropped_(0)
+#ifdef __linux__
+  , fd_(-1)
+#else
+  , file_(nullptr)
+#endif
+{
+  for (size_t i = 0; i < 2; i++)
+  {
+    storage_[i].resize(capacity_ + PCAP_WRITE_ALIGN);
+    uintptr_t addr = reinterpret_cast<uintptr_t>(storage_[i].data());
+    buffers_[i] = storage_[i].data() + (PCAP_WRITE_ALIGN - addr % PCAP_WRITE_ALIGN) % PCAP_WRITE_ALIGN;
+  }
+  unsigned int ip[4] = { 0, 0, 0, 0 };
+  sscanf(device_ip.c_str(), "%u.%u.%u.%u", &ip[0], &ip[1], &ip[2], &ip[3]);
+  const uint8_t hdrs[PCAP_UDP_HDRS_LEN] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0, 0, 0, 0x08, 0x00,  ///< Ethernet, to broadcast
+    0x45, 0, 0, 0, 0, 0, 0x40, 0, 64, 17, 0, 0,                      ///< IPv4, don't fragment, UDP
+    static_cast<uint8_t>(ip[0]), static_cast<uint8_t>(ip[1]), static_cast<uint8_t>(ip[2]),
+    static_cast<uint8_t>(ip[3]), 0xFF, 0xFF, 0xFF, 0xFF,
+    0, 0, 0, 0, 0, 0, 0, 0  ///< UDP, without checksum
+  };
+  memcpy(udp_hdrs_, hdrs, sizeof(hdrs));
+}
+
+inline PcapWriter::~PcapWriter()
+{
+  stop();
+}
+
+inline bool PcapWriter::start()
+{
+  if (thread_.joinable())
+  {
+    return true;
+  }
+  if (!openFile())
+  {
+    excb_(Error(ERRCODE_RECORDFAILED));
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mtx_);
+  active_ = 0;
+  putFileHeader(buffers_[active_]);
+  active_len_ = PCAP_FILE_HDR_LEN;
+  file_bytes_ = 0;
+  writing_ = false;
+  stop_flag_ = false;
+  running_ = true;
+  file_open_time_ = swap_time_ = std::chrono::steady_clock::now();
+  thread_ = std::thread(&PcapWriter::writeLoop, this);
+  return true;
+}
+
+inline void PcapWriter::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_flag_ = true;
+  }
+  cv_.notify_all();
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+}
+
+/**
+ * @brief Append a packet to the active buffer. Takes the lock only to copy the packet, and drops the packet rather
+ * than waiting for the writing thread
+ */
+inline void PcapWriter::record(const PacketMsg& msg, const uint16_t& port, const double& timestamp)
+{
+  const size_t pkt_len = msg.packet.size();
+  const size_t rec_len = PCAP_REC_HDR_LEN + PCAP_UDP_HDRS_LEN + pkt_len;
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (!running_)
+  {
+    return;
+  }
+  bool full = (active_len_ + rec_len > capacity_);
+  bool rotate = (max_file_bytes_ != 0 && file_bytes_ + active_len_ + rec_len > max_file_bytes_ &&
+                 file_bytes_ + active_len_ > PCAP_FILE_HDR_LEN);
+  if ((full || rotate) && !writing_)
+  {
+    swapBuffers(rotate);
+  }
+  if (active_len_ + rec_len > capacity_)
+  {
+    dropped_++;
+    return;
+  }
+
+  uint8_t* rec = buffers_[active_] + active_len_;
+  double sec = std::floor(timestamp);
+  uint32_t rec_hdr[4] = { static_cast<uint32_t>(sec), static_cast<uint32_t>((timestamp - sec) * 1e9),
+                          static_cast<uint32_t>(PCAP_UDP_HDRS_LEN + pkt_len),
+                          static_cast<uint32_t>(PCAP_UDP_HDRS_LEN + pkt_len) };
+  memcpy(rec, rec_hdr, sizeof(rec_hdr));
+  uint8_t* hdrs = rec + PCAP_REC_HDR_LEN;
+  memcpy(hdrs, udp_hdrs_, PCAP_UDP_HDRS_LEN);
+  uint16_t ip_len = static_cast<uint16_t>(20 + 8 + pkt_len);
+  uint16_t udp_len = static_cast<uint16_t>(8 + pkt_len);
+  hdrs[16] = static_cast<uint8_t>(ip_len >> 8);
+  hdrs[17] = static_cast<uint8_t>(ip_len);
+  uint32_t sum = 0;
+  for (size_t i = 14; i < 34; i += 2)
+  {
+    sum += (hdrs[i] << 8) | hdrs[i + 1];
+  }
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  sum = ~((sum & 0xFFFF) + (sum >> 16)) & 0xFFFF;
+  hdrs[24] = static_cast<uint8_t>(sum >> 8);
+  hdrs[25] = static_cast<uint8_t>(sum);
+  hdrs[34] = hdrs[36] = static_cast<uint8_t>(port >> 8);  ///< The LiDAR sends from the same port
+  hdrs[35] = hdrs[37] = static_cast<uint8_t>(port);
+  hdrs[38] = static_cast<uint8_t>(udp_len >> 8);
+  hdrs[39] = static_cast<uint8_t>(udp_len);
+  memcpy(hdrs + PCAP_UDP_HDRS_LEN, msg.packet.data(), pkt_len);
+  active_len_ += rec_len;
+}
+
+/**
+ * @brief Hand the active buffer to the writing thread. Called with the lock held and the writing thread idle.
+ * Without rotation, the bytes beyond the last full write unit are kept for the next write, so that O_DIRECT always
+ * writes whole units. With rotation the whole buffer is written, and the next buffer starts the next file
+ */
+inline void PcapWriter::swapBuffers(const bool& rotate)
+{
+  write_idx_ = active_;
+  write_len_ = active_len_;
+  close_after_write_ = rotate;
+  active_ ^= 1;
+  active_len_ = 0;
+  if (rotate)
+  {
+    putFileHeader(buffers_[active_]);
+    active_len_ = PCAP_FILE_HDR_LEN;
+    file_bytes_ = 0;
+    file_open_time_ = std::chrono::steady_clock::now();
+  }
+  else
+  {
+    size_t tail = write_len_ % align_;
+    write_len_ -= tail;
+    memcpy(buffers_[active_], buffers_[write_idx_] + write_len_, tail);
+    active_len_ = tail;
+    file_bytes_ += write_len_;
+  }
+  writing_ = true;
+  swap_time_ = std::chrono::steady_clock::now();
+  cv_.notify_all();
+}
+
+inline void PcapWriter::writeLoop()
+{
+  std::unique_lock<std::mutex> lock(mtx_);
+  bool last = false;
+  while (!last)
+  {
+    cv_.wait_for(lock, std::chrono::milliseconds(100), [this] { return writing_ || stop_flag_; });
+    if (!writing_)
+    {
+      auto now = std::chrono::steady_clock::now();
+      if (stop_flag_)
+      {
+        swapBuffers(true);  ///< Write everything. The header put for the next file is not written
+        running_ = false;
+        last = true;
+      }
+      else if (param_.max_file_duration != 0 && active_len_ > PCAP_FILE_HDR_LEN &&
+               now - file_open_time_ >= std::chrono::seconds(param_.max_file_duration))
+      {
+        swapBuffers(true);
+      }
+      else if (active_len_ > 0 && now - swap_time_ >= std::chrono::milliseconds(PCAP_FLUSH_INTERVAL_MS))
+      {
+        swapBuffers(false);
+      }
+      else
+      {
+        continue;
+      }
+    }
+    const uint8_t* data = buffers_[write_idx_];
+    size_t len = write_len_;
+    bool rotate = close_after_write_;
+    uint64_t dropped = dropped_;
+    dropped_ = 0;
+    lock.unlock();
+
+    if (dropped != 0)
+    {
+      RS_WARNING << "The recorder dropped " << dropped << " packets, the disk does not keep up" << RS_REND;
+      excb_(Error(ERRCODE_RECORDOVERFLOW));
+    }
+    bool ret = writeFile(data, len);
+    if (rotate)
+    {
+      closeFile();
+      ret = ret && (last || openFile());
+    }
+    if (!ret)
+    {
+      excb_(Error(ERRCODE_RECORDFAILED));
+    }
+
+    lock.lock();
+    writing_ = false;
+    if (!ret)
+    {
+      running_ = false;
+      last = true;
+    }
+  }
+  lock.unlock();
+  closeFile();
+}
+
+inline void PcapWriter::putFileHeader(uint8_t* buf)
+{
+  const uint32_t hdr[6] = { PCAP_WRITE_MAGIC, 0x00040002, 0, 0, 65535, PCAP_LINKTYPE_ETHERNET };  ///< Version 2.4
+  memcpy(buf, hdr, sizeof(hdr));
+}
+
+/**
+ * @brief Numbered path of file index, e.g. record_0000.pcap, record_0001.pcap
+ */
+inline std::string PcapWriter::filePath(const uint32_t& index) const
+{
+  const std::string& path = param_.record_path;
+  size_t dot = path.find_last_of('.');
+  size_t slash = path.find_last_of("/\\");
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+  {
+    dot = path.size();
+  }
+  char suffix[16];
+  snprintf(suffix, sizeof(suffix), "_%04u", index);
+  return path.substr(0, dot) + suffix + path.substr(dot);
+}
+
+/**
+ * @brief Open the next file: record_path itself, or with rotation the next numbered path. Names that are taken are
+ * skipped for the next numbered path
+ */
+inline bool PcapWriter::openFile()
+{
+  bool numbered = (param_.max_file_size != 0 || param_.max_file_duration != 0);
+  std::string path = numbered ? filePath(file_index_++) : param_.record_path;
+  bool direct = false;
+  bool ret = createFile(path, direct);
+  for (uint32_t i = 0; !ret && errno == EEXIST && i < PCAP_MAX_FILE_TRIES; i++)
+  {
+    path = filePath(file_index_++);
+    ret = createFile(path, direct);
+  }
+  if (!ret)
+  {
+    RS_ERROR << "Failed to open " << path << " for recording" << RS_REND;
+  }
+  else if (!numbered && path != param_.record_path)
+  {
+    RS_WARNING << param_.record_path << " exists, recording to " << path << " instead" << RS_REND;
+  }
+  std::lock_guard<std::mutex> lock(mtx_);
+  align_ = direct ? PCAP_WRITE_ALIGN : 1;
+  return ret;
+}
+
+/**
+ * @brief Create path, if it does not exist yet. On failure, errno tells why, e.g. EEXIST
+ */
+inline bool PcapWriter::createFile(const std::string& path, bool& direct)
+{
+  direct = false;
+#ifdef __linux__
+  const int flags = O_WRONLY | O_CREAT | O_EXCL;
+#ifdef O_DIRECT
+  if (param_.use_direct_io)
+  {
+    fd_ = ::open(path.c_str(), flags | O_DIRECT, 0644);
+    direct = (fd_ >= 0);
+    if (!direct && errno != EEXIST)
+    {
+      RS_WARNING << path << " can not be opened with O_DIRECT, it is written through the page cache" << RS_REND;
+      param_.use_direct_io = false;
+    }
+  }
+#endif
+  if (fd_ < 0 && (!param_.use_direct_io || errno != EEXIST))
+  {
+    fd_ = ::open(path.c_str(), flags, 0644);
+  }
+  return (fd_ >= 0);
+#else
+  file_ = fopen(path.c_str(), "wbx");
+  return (file_ != nullptr);
+#endif
+}
+
+/**
+ * @brief Write to the file. With O_DIRECT, len is a multiple of PCAP_WRITE_ALIGN except for the last write to the
+ * file, whose remainder is written after O_DIRECT is switched off
+ */
+inline bool PcapWriter::writeFile(const uint8_t* data, const size_t& len)
+{
+#ifdef __linux__
+  auto write_all = [this](const uint8_t* buf, size_t buf_len) {
+    while (buf_len > 0)
+    {
+      ssize_t ret = ::write(fd_, buf, buf_len);
+      if (ret < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      if (ret <= 0)
+      {
+        return false;
+      }
+      buf += ret;
+      buf_len -= static_cast<size_t>(ret);
+    }
+    return true;
+  };
+  if (fd_ < 0)
+  {
+    return false;
+  }
+  size_t aligned = len - len % align_;
+  if (!write_all(data, aligned))
+  {
+    return false;
+  }
+  if (aligned == len)
+  {
+    return true;
+  }
+#ifdef O_DIRECT
+  fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+#endif
+  return write_all(data + aligned, len - aligned);
+#else
+  return file_ != nullptr && fwrite(data, 1, len, file_) == len;
+#endif
+}
+
+inline void PcapWriter::closeFile()
+{
+#ifdef __linux__
+  if (fd_ >= 0)
+  {
+    ::close(fd_);
+    fd_ = -1;
+  }
+#else
+  if (file_ != nullptr)
+  {
+    fclose(file_);
+    file_ = nullptr;
+  }
+#endif
+}
+}  // namespace lidar
+}  // namespace robosense
@@ -0,0 +1,299 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+
+#pragma once
+#include <rs_driver/common/common_header.h>
+#include <rs_driver/driver/recv_batch.hpp>
+#ifdef __linux__
+#include <map>
+namespace robosense
+{
+namespace lidar
+{
+constexpr int DEMUX_WAIT_MS = 100;        ///< Longest poll wait, i.e. the resolution of the timeouts
+constexpr size_t DEMUX_BATCH_SIZE = 32;   ///< Packets read per recvmmsg() call
+constexpr size_t DEMUX_MAX_BATCHES = 16;  ///< Batches read per wakeup before the timeouts are checked
+constexpr size_t DEMUX_MAX_ROUTES = 255;  ///< Limited by the jump offsets of the socket filter
+
+/**
+ * @brief One UDP socket shared by several LiDARs sending to the same port, demultiplexed by source address. Packets
+ * of unknown sources are dropped by a socket filter in the kernel, before they are queued or copied. Every port is
+ * read by one thread, whichever number of LiDARs share it. Linux only
+ */
+class PortDemux
+{
+public:
+  typedef std::shared_ptr<PortDemux> Ptr;
+  typedef std::function<void(std::vector<PacketMsg>&)> Handler;
+  /**
+   * @brief The demux of port, opened on first use and shared by the later calls while it is in use. Its receive
+   * buffer is the largest recv_buffer_size asked for, if any
+   * @return nullptr if the port cannot be opened
+   */
+  static inline Ptr open(const uint16_t& port, const std::string& multicast_address, const bool& use_hw_timestamp,
+                         const uint32_t& recv_buffer_size);
+  ~PortDemux();
+  PortDemux(const PortDemux&) = delete;
+  PortDemux& operator=(const PortDemux&) = delete;
+  /**
+   * @brief Pass the packets of src_addr (IPv4, host byte order) to handler, in batches. on_timeout is called every
+   * timeout(s) without packets of src_addr. Fails if src_addr has a route already
+   */
+  inline bool addRoute(const uint32_t& src_addr, const Handler& handler, const double& timeout,
+                       const std::function<void()>& on_timeout);
+  inline void removeRoute(const uint32_t& src_addr);  ///< On return, the handlers of src_addr are not called any more
+
+private:
+  struct Route
+  {
+    Handler handler;
+    std::function<void()> on_timeout;
+    std::chrono::steady_clock::duration timeout;
+    std::chrono::steady_clock::time_point last_time;  ///< Last time a packet came or the route timed out
+    std::vector<PacketMsg> pkts;                      ///< Packets of the current batch
+  };
+
+  explicit PortDemux(const uint16_t& port);
+  inline bool bind(const std::string& multicast_address, const bool& use_hw_timestamp,
+                   const uint32_t& recv_buffer_size);
+  inline bool updateFilter();
+  inline void run();
+
+private:
+  uint16_t port_;
+  int fd_;
+  uint32_t recv_buffer_size_;
+  PacketPool::Ptr pkt_pool_;
+  RecvBatch recv_batch_;
+  std::mutex mutex_;  ///< Held while the handlers run, so that removeRoute() waits for them
+  std::map<uint32_t, Route> routes_;
+  std::atomic<bool> stop_flag_;
+  std::thread thread_;
+};
+
+inline PortDemux::Ptr PortDemux::open(const uint16_t& port, const std::string& multicast_address,
+                                      const bool& use_hw_timestamp, const uint32_t& recv_buffer_size)
+{
+  static std::mutex registry_mutex;
+  static std::map<uint16_t, std::weak_ptr<PortDemux>> registry;
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  Ptr demux = registry[port].lock();
+  if (demux == nullptr)
+  {
+    demux.reset(new PortDemux(port));
+    registry[port] = demux;
+  }
+  if (!demux->bind(multicast_address, use_hw_timestamp, recv_buffer_size))
+  {
+    return nullptr;
+  }
+  return demux;
+}
+
+inline PortDemux::PortDemux(const uint16_t& port)
+  : port_(port)
+  , fd_(-1)
+  , recv_buffer_size_(0)
+  , pkt_pool_(std::make_shared<PacketPool>(std::max(MECH_PKT_LEN, std::max(MEMS_MSOP_LEN, MEMS_DIFOP_LEN))))
+  , stop_flag_(false)
+{
+  recv_batch_.init(DEMUX_BATCH_SIZE, pkt_pool_->slotSize());
+}
+
+inline PortDemux::~PortDemux()
+{
+  stop_flag_.store(true);
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+  if (fd_ >= 0)
+  {
+    close(fd_);
+  }
+}
+
+/* Open the socket on first use, and join multicast_address if it is given. Called under the registry lock */
+inline bool PortDemux::bind(const std::string& multicast_address, const bool& use_hw_timestamp,
+                            const uint32_t& recv_buffer_size)
+{
+  if (fd_ < 0)
+  {
+    fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0)
+    {
+      return false;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port_);
+    if (!updateFilter() || ::bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+      close(fd_);
+      fd_ = -1;
+      return false;
+    }
+    enableRecvTimestamp(fd_, use_hw_timestamp);
+    thread_ = std::thread([this]() { run(); });
+  }
+  if (multicast_address != "0.0.0.0")
+  {
+    struct ip_mreq mreq;
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (inet_pton(AF_INET, multicast_address.c_str(), &mreq.imr_multiaddr) != 1 ||
+        (setsockopt(fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0 && errno != EADDRINUSE))
+    {
+      RS_WARNING << "Failed to join multicast group " << multicast_address << " on port " << port_ << RS_REND;
+    }
+  }
+  if (recv_buffer_size > recv_buffer_size_)
+  {
+    recv_buffer_size_ = recv_buffer_size;
+    setRecvBufferSize(fd_, recv_buffer_size_);
+  }
+  return true;
+}
+
+inline bool PortDemux::addRoute(const uint32_t& src_addr, const Handler& handler, const double& timeout,
+                                const std::function<void()>& on_timeout)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (routes_.count(src_addr) != 0 || routes_.size() >= DEMUX_MAX_ROUTES)
+  {
+    return false;
+  }
+  Route& route = routes_[src_addr];
+  route.handler = handler;
+  route.on_timeout = on_timeout;
+  route.timeout =
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout));
+  route.last_time = std::chrono::steady_clock::now();
+  route.pkts.reserve(DEMUX_BATCH_SIZE);
+  if (!updateFilter())
+  {
+    routes_.erase(src_addr);
+    return false;
+  }
+  return true;
+}
+
+inline void PortDemux::removeRoute(const uint32_t& src_addr)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (routes_.erase(src_addr) != 0)
+  {
+    updateFilter();
+  }
+}
+
+/* Let the kernel accept only the packets of the routed sources. The filter compares the source address of the IP
+ * header with each of them, and accepts the whole packet on a match:
+ *   ld [ip src]; jeq addr_0, accept; ...; jeq addr_n-1, accept; ret 0; accept: ret -1 */
+inline bool PortDemux::updateFilter()
+{
+  std::vector<struct sock_filter> code;
+  code.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<uint32_t>(SKF_NET_OFF + 12)));
+  size_t num = routes_.size();
+  size_t i = 0;
+  for (const auto& iter : routes_)
+  {
+    code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, iter.first, static_cast<uint8_t>(num - i), 0));
+    i++;
+  }
+  code.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+  code.push_back(BPF_STMT(BPF_RET | BPF_K, 0xFFFFFFFF));
+  struct sock_fprog prog;
+  prog.len = static_cast<unsigned short>(code.size());
+  prog.filter = code.data();
+  if (setsockopt(fd_, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) != 0)
+  {
+    RS_ERROR << "Failed to set the source filter of port " << port_ << ": " << strerror(errno) << RS_REND;
+    return false;
+  }
+  return true;
+}
+
+inline void PortDemux::run()
+{
+  struct pollfd pfd;
+  pfd.fd = fd_;
+  pfd.events = POLLIN;
+  while (!stop_flag_.load())
+  {
+    int ret = poll(&pfd, 1, DEMUX_WAIT_MS);
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (size_t n = 0; ret > 0 && n < DEMUX_MAX_BATCHES; n++)
+    {
+      int npkts = recv_batch_.recv(fd_, *pkt_pool_);
+      for (int i = 0; i < npkts; i++)
+      {
+        auto iter = routes_.find(recv_batch_.srcAddr(i));
+        if (iter == routes_.end())  ///< Queued before its route was removed
+        {
+          continue;
+        }
+        recv_batch_.buffers[i].resize(recv_batch_.msgs[i].msg_len);
+        iter->second.pkts.emplace_back(std::move(recv_batch_.buffers[i]));
+      }
+      for (auto& iter : routes_)
+      {
+        if (!iter.second.pkts.empty())
+        {
+          iter.second.last_time = now;
+          iter.second.handler(iter.second.pkts);
+          iter.second.pkts.clear();
+        }
+      }
+      if (npkts < static_cast<int>(DEMUX_BATCH_SIZE))
+      {
+        break;
+      }
+    }
+    for (auto& iter : routes_)
+    {
+      if (now - iter.second.last_time >= iter.second.timeout)
+      {
+        iter.second.last_time = now;
+        iter.second.on_timeout();
+      }
+    }
+  }
+}
+
+}  // namespace lidar
+}  // namespace robosense
+#endif
@@ -0,0 +1,247 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+
+#pragma once
+#include <rs_driver/common/common_header.h>
+#include <rs_driver/msg/packet_msg.h>
+#include <rs_driver/utility/time.h>
+#ifdef __linux__
+constexpr size_t RECV_CONTROL_LEN =
+    CMSG_SPACE(sizeof(struct scm_timestamping)) + CMSG_SPACE(sizeof(uint32_t));  ///< Receive time and drop counter
+namespace robosense
+{
+namespace lidar
+{
+union RecvControl  ///< Control message buffer of one packet, aligned for the cmsghdr read from it
+{
+  char buf[RECV_CONTROL_LEN];
+  struct cmsghdr align;
+};
+
+/* Ask the kernel for the receive time of every packet of socket fd, see readRecvTime() */
+inline void enableRecvTimestamp(const int& fd, const bool& use_hw_timestamp)
+{
+  if (use_hw_timestamp)
+  {
+    int flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_RX_SOFTWARE |
+                SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0)
+    {
+      return;
+    }
+    RS_WARNING << "Hardware receive timestamps are not supported, use the kernel ones" << RS_REND;
+  }
+  int on = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) != 0)
+  {
+    RS_WARNING << "Kernel receive timestamps are not supported, stamp the packets when they are read" << RS_REND;
+  }
+}
+
+/* Ask the kernel for the number of packets it dropped on socket fd, see DropCounter. Packets rejected by a socket
+ * filter count as dropped too, so it is only useful on sockets without one */
+inline void enableRecvDropCount(const int& fd)
+{
+  int on = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) != 0)
+  {
+    RS_WARNING << "Kernel drop counters are not supported" << RS_REND;
+  }
+}
+
+/* Set the receive buffer of socket fd to size bytes. Sizes above net.core.rmem_max need CAP_NET_ADMIN */
+inline void setRecvBufferSize(const int& fd, const uint32_t& size)
+{
+  int val = static_cast<int>(std::min<uint32_t>(size, std::numeric_limits<int>::max() / 2));
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &val, sizeof(val));
+  int actual = 0;
+  socklen_t len = sizeof(actual);
+  getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &actual, &len);
+  actual /= 2;  ///< The kernel reports twice the size, with room for its bookkeeping
+  if (actual >= val || setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &val, sizeof(val)) == 0)
+  {
+    return;
+  }
+  RS_WARNING << "The receive buffer is limited to " << actual << " bytes instead of " << size
+             << ". Raise net.core.rmem_max, or grant CAP_NET_ADMIN" << RS_REND;
+}
+
+/**
+ * @brief Packets the kernel dropped on one socket, e.g. because its receive buffer was full. The kernel counter of
+ * SO_RXQ_OVFL comes with the packets received after the first drop, and is 32 bits
+ */
+struct DropCounter
+{
+  std::atomic<uint64_t> total{0};
+  uint32_t last = 0;  ///< Kernel counter as of the last packet, only used by the receiving thread
+
+  inline void update(struct msghdr& hdr)
+  {
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+    {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+      {
+        uint32_t count;
+        memcpy(&count, CMSG_DATA(cmsg), sizeof(count));
+        total.fetch_add(static_cast<uint32_t>(count - last), std::memory_order_relaxed);
+        last = count;
+      }
+    }
+  }
+};
+
+/* Receive time found in the control messages of a packet: the NIC time if there is one, else the kernel time. If
+ * the kernel gave neither, the current time */
+inline double readRecvTime(struct msghdr& hdr)
+{
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+  {
+    if (cmsg->cmsg_level != SOL_SOCKET)
+    {
+      continue;
+    }
+    struct timespec ts;
+    if (cmsg->cmsg_type == SCM_TIMESTAMPNS)
+    {
+      memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+    }
+    else if (cmsg->cmsg_type == SCM_TIMESTAMPING)
+    {
+      struct scm_timestamping stamps;
+      memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+      ts = (stamps.ts[2].tv_sec != 0) ? stamps.ts[2] : stamps.ts[0];  ///< ts[2]: hardware, ts[0]: software
+    }
+    else
+    {
+      continue;
+    }
+    if (ts.tv_sec != 0)
+    {
+      return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+    }
+  }
+  return getTime();
+}
+
+/* Read one waiting packet into buffer and stamp it with its receive time. Returns -1 if no packet is waiting */
+inline ssize_t recvPacket(const int& fd, PacketBuffer& buffer, const size_t& len, DropCounter& drops)
+{
+  struct iovec iov;
+  iov.iov_base = buffer.data();
+  iov.iov_len = len;
+  RecvControl control;
+  struct msghdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.msg_iov = &iov;
+  hdr.msg_iovlen = 1;
+  hdr.msg_control = control.buf;
+  hdr.msg_controllen = sizeof(control.buf);
+  ssize_t ret = recvmsg(fd, &hdr, MSG_DONTWAIT);
+  if (ret >= 0)
+  {
+    buffer.setTimestamp(readRecvTime(hdr));
+    drops.update(hdr);
+  }
+  return ret;
+}
+
+/**
+ * @brief Buffers of the packets read by one recvmmsg() call. The buffers come from a packet pool, and the ones moved
+ * out after a call are replaced by the next call
+ */
+struct RecvBatch
+{
+  std::vector<PacketBuffer> buffers;
+  std::vector<struct iovec> iovecs;
+  std::vector<struct mmsghdr> msgs;
+  std::vector<struct sockaddr_in> addrs;  ///< Source addresses
+  std::vector<RecvControl> control;       ///< Control messages
+  std::vector<PacketMsg> batch;           ///< For the user of the batch to collect the packets passed on
+  DropCounter drops;
+
+  inline void init(const size_t& batch_size, const size_t& pkt_len)
+  {
+    buffers.resize(batch_size);
+    iovecs.resize(batch_size);
+    msgs.resize(batch_size);
+    addrs.resize(batch_size);
+    control.resize(batch_size);
+    for (size_t i = 0; i < batch_size; i++)
+    {
+      iovecs[i].iov_len = pkt_len;
+      memset(&msgs[i], 0, sizeof(struct mmsghdr));
+      msgs[i].msg_hdr.msg_iov = &iovecs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      msgs[i].msg_hdr.msg_name = &addrs[i];
+      msgs[i].msg_hdr.msg_control = control[i].buf;
+    }
+    batch.reserve(batch_size);
+  }
+
+  /**
+   * @brief Read the waiting packets of fd, up to one batch, and stamp them with their receive time
+   * @return The number of packets read, whose lengths are in msgs[i].msg_len. 0 or less if none was waiting
+   */
+  inline int recv(const int& fd, PacketPool& pool)
+  {
+    for (size_t i = 0; i < msgs.size(); i++)
+    {
+      if (buffers[i].data() == nullptr)
+      {
+        buffers[i] = pool.allocate();
+        iovecs[i].iov_base = buffers[i].data();
+      }
+      msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+      msgs[i].msg_hdr.msg_controllen = RECV_CONTROL_LEN;  ///< The kernel shrinks both to the lengths used
+    }
+    int npkts = recvmmsg(fd, msgs.data(), msgs.size(), MSG_DONTWAIT, NULL);
+    for (int i = 0; i < npkts; i++)
+    {
+      buffers[i].setTimestamp(readRecvTime(msgs[i].msg_hdr));
+    }
+    if (npkts > 0)
+    {
+      drops.update(msgs[npkts - 1].msg_hdr);  ///< The counter only grows, the last packet has the latest
+    }
+    return npkts;
+  }
+
+  inline uint32_t srcAddr(const size_t& idx) const  ///< IPv4 source address of a packet, host byte order
+  {
+    return ntohl(addrs[idx].sin_addr.s_addr);
+  }
+};
+
+}  // namespace lidar
+}  // namespace robosense
+#endif
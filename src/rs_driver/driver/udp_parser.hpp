@@ -0,0 +1,336 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+#include <rs_driver/driver/pcap_reader.hpp>
+namespace robosense
+{
+namespace lidar
+{
+constexpr size_t IP_REASSEMBLY_MAX_DATAGRAMS = 8;  ///< Fragmented datagrams reassembled at the same time
+constexpr double IP_REASSEMBLY_TIMEOUT = 1.0;      ///< unit: s, incomplete datagrams older than this are dropped
+
+struct UdpDatagram  ///< UDP payload found in a captured packet
+{
+  uint32_t src_addr = 0;  ///< IPv4 source address, host byte order. 0 for IPv6
+  uint16_t dst_port = 0;
+  const uint8_t* payload = nullptr;  ///< Valid until the next packet is parsed
+  uint32_t payload_len = 0;
+};
+
+/**
+ * @brief Finds the UDP payload of captured packets. Supports Ethernet with 802.1Q/802.1ad tags, Linux cooked
+ * capture (SLL, SLL2), loopback and raw IP link layers, IPv4 with options and IPv6 with extension headers, and
+ * reassembles fragmented datagrams. Never reads past the captured bytes.
+ */
+class UdpParser
+{
+public:
+  inline bool parse(const PcapPacket& pkt, UdpDatagram& udp);
+
+private:
+  typedef std::array<uint8_t, 37> FragmentKey;  ///< IP version, source and destination address, identification
+  struct FragmentedDatagram
+  {
+    bool used = false;
+    FragmentKey key;
+    double timestamp = 0;         ///< Capture time of the first fragment
+    uint32_t total_len = 0;       ///< Length of the IP payload, 0 until the last fragment arrived
+    uint32_t received_units = 0;  ///< Number of 8 bytes units received
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> units;  ///< 1 if the 8 bytes unit is received
+  };
+  inline bool parseIpv4(const uint8_t* ip, const uint32_t& len, const double& timestamp, UdpDatagram& udp);
+  inline bool parseIpv6(const uint8_t* ip, const uint32_t& len, const double& timestamp, UdpDatagram& udp);
+  inline bool parseUdp(const uint8_t* data, const uint32_t& len, UdpDatagram& udp);
+  inline bool reassemble(const FragmentKey& key, const uint32_t& offset, const bool& more, const uint8_t* data,
+                         const uint32_t& len, const double& timestamp, UdpDatagram& udp);
+  inline FragmentedDatagram& findDatagram(const FragmentKey& key, const double& timestamp);
+  static inline uint16_t read16(const uint8_t* p)
+  {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+  }
+
+private:
+  std::vector<FragmentedDatagram> datagrams_;
+};
+
+constexpr uint16_t ETHERTYPE_IPV4 = 0x0800;
+constexpr uint16_t ETHERTYPE_IPV6 = 0x86DD;
+constexpr uint16_t ETHERTYPE_VLAN = 0x8100;
+constexpr uint16_t ETHERTYPE_QINQ = 0x88A8;
+constexpr uint16_t ETHERTYPE_QINQ_OLD = 0x9100;
+constexpr uint8_t IP_PROTO_UDP = 17;
+constexpr uint32_t IP_MAX_PAYLOAD_LEN = 65535;
+
+inline bool UdpParser::parse(const PcapPacket& pkt, UdpDatagram& udp)
+{
+  const uint8_t* p = pkt.data;
+  uint32_t len = pkt.caplen;
+  uint32_t hdr_len = 0;
+  uint16_t proto = 0;  ///< Ethertype, 0 if given by the version field of the IP header
+  switch (pkt.link_type)
+  {
+    case PCAP_LINKTYPE_ETHERNET:
+      hdr_len = 14;
+      proto = (len < hdr_len) ? 0 : read16(p + 12);
+      break;
+    case PCAP_LINKTYPE_LINUX_SLL:
+      hdr_len = 16;
+      proto = (len < hdr_len) ? 0 : read16(p + 14);
+      break;
+    case PCAP_LINKTYPE_LINUX_SLL2:
+      hdr_len = 20;
+      proto = (len < hdr_len) ? 0 : read16(p);
+      break;
+    case PCAP_LINKTYPE_NULL:
+    case PCAP_LINKTYPE_LOOP:
+      hdr_len = 4;
+      break;
+    case PCAP_LINKTYPE_RAW:
+    case PCAP_LINKTYPE_IPV4:
+    case PCAP_LINKTYPE_IPV6:
+      break;
+    default:
+      return false;
+  }
+  if (len < hdr_len)
+  {
+    return false;
+  }
+  p += hdr_len;
+  len -= hdr_len;
+  while (proto == ETHERTYPE_VLAN || proto == ETHERTYPE_QINQ || proto == ETHERTYPE_QINQ_OLD)
+  {
+    if (len < 4)
+    {
+      return false;
+    }
+    proto = read16(p + 2);
+    p += 4;
+    len -= 4;
+  }
+  if (proto == 0)
+  {
+    proto = (len > 0 && (p[0] >> 4) == 6) ? ETHERTYPE_IPV6 : ETHERTYPE_IPV4;
+  }
+  switch (proto)
+  {
+    case ETHERTYPE_IPV4:
+      return parseIpv4(p, len, pkt.timestamp, udp);
+    case ETHERTYPE_IPV6:
+      return parseIpv6(p, len, pkt.timestamp, udp);
+    default:
+      return false;
+  }
+}
+
+inline bool UdpParser::parseIpv4(const uint8_t* ip, const uint32_t& len, const double& timestamp, UdpDatagram& udp)
+{
+  if (len < 20 || (ip[0] >> 4) != 4 || ip[9] != IP_PROTO_UDP)
+  {
+    return false;
+  }
+  uint32_t hdr_len = (ip[0] & 0x0F) * 4;
+  uint32_t total_len = read16(ip + 2);
+  if (hdr_len < 20 || hdr_len > len || total_len < hdr_len)
+  {
+    return false;
+  }
+  uint32_t payload_len = std::min(total_len, len) - hdr_len;  ///< Without the ethernet padding
+  udp.src_addr = (static_cast<uint32_t>(read16(ip + 12)) << 16) | read16(ip + 14);
+  uint16_t frag = read16(ip + 6);
+  bool more = (frag & 0x2000) != 0;
+  uint32_t frag_offset = (frag & 0x1FFF) * 8;
+  if (!more && frag_offset == 0)
+  {
+    return parseUdp(ip + hdr_len, payload_len, udp);
+  }
+  if (total_len > len)  ///< Truncated by the capture
+  {
+    return false;
+  }
+  FragmentKey key;
+  key.fill(0);
+  key[0] = 4;
+  memcpy(&key[1], ip + 12, 4);
+  memcpy(&key[17], ip + 16, 4);
+  memcpy(&key[33], ip + 4, 2);
+  return reassemble(key, frag_offset, more, ip + hdr_len, payload_len, timestamp, udp);
+}
+
+inline bool UdpParser::parseIpv6(const uint8_t* ip, const uint32_t& len, const double& timestamp, UdpDatagram& udp)
+{
+  const uint32_t HDR_LEN = 40;
+  if (len < HDR_LEN || (ip[0] >> 4) != 6)
+  {
+    return false;
+  }
+  uint32_t end = HDR_LEN + read16(ip + 4);
+  if (end > len)
+  {
+    end = len;
+  }
+  udp.src_addr = 0;
+  uint8_t next_hdr = ip[6];
+  uint32_t offset = HDR_LEN;
+  const uint8_t* frag_hdr = nullptr;
+  while (next_hdr != IP_PROTO_UDP)
+  {
+    if (end - offset < 8)
+    {
+      return false;
+    }
+    const uint8_t* ext = ip + offset;
+    uint32_t ext_len;
+    switch (next_hdr)
+    {
+      case 0:   ///< Hop-by-hop options
+      case 43:  ///< Routing
+      case 60:  ///< Destination options
+        ext_len = (ext[1] + 1) * 8;
+        break;
+      case 44:  ///< Fragment
+        ext_len = 8;
+        frag_hdr = ext;
+        break;
+      case 51:  ///< Authentication
+        ext_len = (ext[1] + 2) * 4;
+        break;
+      default:
+        return false;
+    }
+    if (ext_len > end - offset)
+    {
+      return false;
+    }
+    next_hdr = ext[0];
+    offset += ext_len;
+  }
+  uint32_t frag_offset = (frag_hdr == nullptr) ? 0 : (read16(frag_hdr + 2) & 0xFFF8);
+  bool more = (frag_hdr != nullptr) && (frag_hdr[3] & 0x01);
+  if (!more && frag_offset == 0)
+  {
+    return parseUdp(ip + offset, end - offset, udp);
+  }
+  if (HDR_LEN + read16(ip + 4) > len)  ///< Truncated by the capture
+  {
+    return false;
+  }
+  FragmentKey key;
+  key.fill(0);
+  key[0] = 6;
+  memcpy(&key[1], ip + 8, 16);
+  memcpy(&key[17], ip + 24, 16);
+  memcpy(&key[33], frag_hdr + 4, 4);
+  return reassemble(key, frag_offset, more, ip + offset, end - offset, timestamp, udp);
+}
+
+inline bool UdpParser::parseUdp(const uint8_t* data, const uint32_t& len, UdpDatagram& udp)
+{
+  const uint32_t HDR_LEN = 8;
+  if (len < HDR_LEN)
+  {
+    return false;
+  }
+  uint32_t udp_len = read16(data + 4);
+  if (udp_len < HDR_LEN)
+  {
+    return false;
+  }
+  udp.dst_port = read16(data + 2);
+  udp.payload = data + HDR_LEN;
+  udp.payload_len = std::min(udp_len, len) - HDR_LEN;
+  return true;
+}
+
+inline bool UdpParser::reassemble(const FragmentKey& key, const uint32_t& offset, const bool& more,
+                                  const uint8_t* data, const uint32_t& len, const double& timestamp, UdpDatagram& udp)
+{
+  if (offset + len > IP_MAX_PAYLOAD_LEN || (more && (len == 0 || len % 8 != 0)))
+  {
+    return false;
+  }
+  FragmentedDatagram& dgram = findDatagram(key, timestamp);
+  memcpy(dgram.data.data() + offset, data, len);
+  for (uint32_t unit = offset / 8; unit < (offset + len + 7) / 8; unit++)
+  {
+    dgram.received_units += 1 - dgram.units[unit];
+    dgram.units[unit] = 1;
+  }
+  if (!more)
+  {
+    dgram.total_len = offset + len;
+  }
+  if (dgram.total_len == 0 || dgram.received_units < (dgram.total_len + 7) / 8)
+  {
+    return false;
+  }
+  dgram.used = false;  ///< The data stays untouched until the next fragment is parsed
+  return parseUdp(dgram.data.data(), dgram.total_len, udp);
+}
+
+inline UdpParser::FragmentedDatagram& UdpParser::findDatagram(const FragmentKey& key, const double& timestamp)
+{
+  FragmentedDatagram* slot = nullptr;
+  for (auto& dgram : datagrams_)
+  {
+    if (dgram.used && std::abs(timestamp - dgram.timestamp) > IP_REASSEMBLY_TIMEOUT)
+    {
+      dgram.used = false;
+    }
+    if (dgram.used && dgram.key == key)
+    {
+      return dgram;
+    }
+    if (slot == nullptr || (slot->used && (!dgram.used || dgram.timestamp < slot->timestamp)))
+    {
+      slot = &dgram;  ///< A free one, or else the oldest one
+    }
+  }
+  if (datagrams_.size() < IP_REASSEMBLY_MAX_DATAGRAMS && (slot == nullptr || slot->used))
+  {
+    datagrams_.emplace_back();
+    slot = &datagrams_.back();
+    slot->data.resize(IP_MAX_PAYLOAD_LEN);
+    slot->units.resize((IP_MAX_PAYLOAD_LEN + 7) / 8);
+  }
+  slot->used = true;
+  slot->key = key;
+  slot->timestamp = timestamp;
+  slot->total_len = 0;
+  slot->received_units = 0;
+  std::fill(slot->units.begin(), slot->units.end(), 0);
+  return *slot;
+}
+}  // namespace lidar
+}  // namespace robosense
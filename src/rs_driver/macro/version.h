@@ -0,0 +1,3 @@
+#define RSLIDAR_VERSION_MAJOR 1
+#define RSLIDAR_VERSION_MINOR 3
+#define RSLIDAR_VERSION_PATCH 0
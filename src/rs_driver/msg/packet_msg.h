@@ -32,6 +32,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 #include <rs_driver/common/common_header.h>
+#include <rs_driver/utility/packet_pool.h>
 
 namespace robosense
 {
@@ -48,17 +49,15 @@ struct __declspec(align(16)) PacketMsg
 struct __attribute__((aligned(16))) PacketMsg  ///< LiDAR single packet message
 #endif
 {
-  std::vector<uint8_t> packet;
+  PacketBuffer packet;  ///< Packet data. Copies of the message share the buffer until one of them writes to it
   PacketMsg()
   {
   }
-  PacketMsg(const PacketMsg& msg)
+  PacketMsg(const size_t& pkt_length) : packet(pkt_length)
   {
-    this->packet.assign(msg.packet.begin(), msg.packet.end());
   }
-  PacketMsg(const size_t& pkt_length)
+  explicit PacketMsg(PacketBuffer&& buffer) : packet(std::move(buffer))
   {
-    packet.resize(pkt_length);
   }
 };
 }  // namespace lidar
@@ -0,0 +1,131 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+#include <rs_driver/common/common_header.h>
+namespace robosense
+{
+namespace lidar
+{
+/**
+ * @brief Point cloud stored as one column per field (structure of arrays). Point i is made of x[i], y[i], z[i],
+ * intensity[i], ring[i] and timestamp[i], so all the columns always have the same size
+ */
+struct PointCloudSoA
+{
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+  std::vector<uint8_t> intensity;
+  std::vector<uint16_t> ring;
+  std::vector<double> timestamp;
+
+  inline size_t size() const
+  {
+    return x.size();
+  }
+
+  inline bool empty() const
+  {
+    return x.empty();
+  }
+
+  inline void resize(const size_t& num)
+  {
+    x.resize(num);
+    y.resize(num);
+    z.resize(num);
+    intensity.resize(num);
+    ring.resize(num);
+    timestamp.resize(num);
+  }
+
+  inline void reserve(const size_t& num)
+  {
+    x.reserve(num);
+    y.reserve(num);
+    z.reserve(num);
+    intensity.reserve(num);
+    ring.reserve(num);
+    timestamp.reserve(num);
+  }
+
+  inline void clear()
+  {
+    resize(0);
+  }
+
+  inline void append(const PointCloudSoA& other)
+  {
+    x.insert(x.end(), other.x.begin(), other.x.end());
+    y.insert(y.end(), other.y.begin(), other.y.end());
+    z.insert(z.end(), other.z.begin(), other.z.end());
+    intensity.insert(intensity.end(), other.intensity.begin(), other.intensity.end());
+    ring.insert(ring.end(), other.ring.begin(), other.ring.end());
+    timestamp.insert(timestamp.end(), other.timestamp.begin(), other.timestamp.end());
+  }
+};
+
+/**
+ * @brief One point of a PointCloudSoA, used by the decoders to fill the columns with setX(), setY() ...
+ */
+struct PointCloudSoARef
+{
+  PointCloudSoA& cloud;
+  size_t idx;
+};
+
+#ifdef _MSC_VER
+struct __declspec(align(16)) PointCloudSoAMsg
+#elif __GNUC__
+struct __attribute__((aligned(16))) PointCloudSoAMsg
+#endif
+{
+  typedef PointCloudSoA PointCloud;
+  typedef std::shared_ptr<PointCloud> PointCloudPtr;
+  typedef std::shared_ptr<const PointCloud> PointCloudConstPtr;
+  double timestamp = 0.0;
+  std::string frame_id = "";      ///< Point cloud frame id
+  uint32_t seq = 0;               ///< Sequence number of message
+  uint32_t height = 0;            ///< Height of point cloud
+  uint32_t width = 0;             ///< Width of point cloud
+  bool is_dense = false;          ///< If is_dense=true, the point cloud does not contain NAN points
+  PointCloudPtr point_cloud_ptr;  ///< Point cloud pointer
+  PointCloudSoAMsg() = default;
+  explicit PointCloudSoAMsg(const PointCloudPtr& ptr) : point_cloud_ptr(ptr)
+  {
+  }
+  typedef std::shared_ptr<PointCloudSoAMsg> Ptr;
+  typedef std::shared_ptr<const PointCloudSoAMsg> ConstPtr;
+};
+}  // namespace lidar
+}  // namespace robosense
@@ -0,0 +1,121 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+#include <rs_driver/common/common_header.h>
+namespace robosense
+{
+namespace lidar
+{
+/**
+ * @brief Pool of frame buffers (std::vector<T_Point>, PointCloudSoA ...) handed out as std::shared_ptr. When the last
+ * reference of a frame is dropped, the frame goes back to the pool with its points and capacity kept, so after
+ * warm-up no large allocation is done per frame. Frames keep the pool alive until they are released.
+ */
+template <typename T_Frame>
+class FramePool : public std::enable_shared_from_this<FramePool<T_Frame>>
+{
+public:
+  typedef std::shared_ptr<FramePool<T_Frame>> Ptr;
+  inline explicit FramePool(const size_t& max_free_num = 8) : max_free_num_(max_free_num)
+  {
+  }
+  FramePool(const FramePool&) = delete;
+  FramePool& operator=(const FramePool&) = delete;
+
+  /**
+   * @brief Get an empty frame which can hold at least point_num points without reallocation
+   */
+  inline std::shared_ptr<T_Frame> allocate(const size_t& point_num)
+  {
+    std::unique_ptr<T_Frame> frame = take();
+    frame->clear();
+    frame->reserve(point_num);
+    return wrap(std::move(frame));
+  }
+
+  /**
+   * @brief Get a frame of point_num points, for a caller that overwrites all of them. The points left from the
+   * previous use of the frame are not initialized again, only the ones it grows by
+   */
+  inline std::shared_ptr<T_Frame> allocateResized(const size_t& point_num)
+  {
+    std::unique_ptr<T_Frame> frame = take();
+    frame->resize(point_num);
+    return wrap(std::move(frame));
+  }
+
+  inline size_t freeNum()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_frames_.size();
+  }
+
+private:
+  inline std::unique_ptr<T_Frame> take()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!free_frames_.empty())
+      {
+        std::unique_ptr<T_Frame> frame = std::move(free_frames_.back());
+        free_frames_.pop_back();
+        return frame;
+      }
+    }
+    return std::unique_ptr<T_Frame>(new T_Frame);
+  }
+
+  inline std::shared_ptr<T_Frame> wrap(std::unique_ptr<T_Frame>&& frame)
+  {
+    std::shared_ptr<FramePool<T_Frame>> pool = this->shared_from_this();
+    return std::shared_ptr<T_Frame>(frame.release(), [pool](T_Frame* frame) { pool->release(frame); });
+  }
+
+  inline void release(T_Frame* frame)
+  {
+    std::unique_ptr<T_Frame> ptr(frame);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_frames_.size() < max_free_num_)  ///< Frames beyond the limit are freed, e.g. after a slow consumer
+    {
+      free_frames_.emplace_back(std::move(ptr));
+    }
+  }
+
+private:
+  const size_t max_free_num_;
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<T_Frame>> free_frames_;
+};
+
+}  // namespace lidar
+}  // namespace robosense
@@ -56,6 +56,15 @@ public:
     queue_.push(value);
   }
 
+  inline void push(const std::vector<T>& values)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& value : values)
+    {
+      queue_.push(value);
+    }
+  }
+
   inline void pop()
   {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -0,0 +1,341 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+#include <rs_driver/common/common_header.h>
+namespace robosense
+{
+namespace lidar
+{
+class PacketPool;
+
+struct PacketSlot  ///< Reference counted storage of one packet
+{
+  std::atomic<uint32_t> ref_count;
+  uint32_t size;
+  uint32_t capacity;
+  uint8_t* data;
+  double timestamp;                  ///< Receive time, unit: s. 0 if unknown
+  std::shared_ptr<PacketPool> pool;  ///< The pool this slot belongs to. Empty for standalone slots
+};
+
+/**
+ * @brief Handle of a packet slot. Copies share the same storage, so copying a packet only increases a reference
+ * count. Writing through a shared handle (data(), operator[], setTimestamp(), resize(), assign()) first copies the
+ * packet, so copies never see each other's changes. Read through const handles to avoid the copy. The slot goes back
+ * to its pool (or is freed if it is standalone) when the last handle is destroyed.
+ */
+class PacketBuffer
+{
+public:
+  inline PacketBuffer() : slot_(nullptr)
+  {
+  }
+
+  inline explicit PacketBuffer(const size_t& size) : slot_(newStandaloneSlot(size))
+  {
+  }
+
+  inline PacketBuffer(const PacketBuffer& other) : slot_(other.slot_)
+  {
+    if (slot_ != nullptr)
+    {
+      slot_->ref_count.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  inline PacketBuffer(PacketBuffer&& other) noexcept : slot_(other.slot_)
+  {
+    other.slot_ = nullptr;
+  }
+
+  inline PacketBuffer& operator=(const PacketBuffer& other)
+  {
+    if (this != &other)
+    {
+      PacketBuffer tmp(other);
+      std::swap(slot_, tmp.slot_);
+    }
+    return *this;
+  }
+
+  inline PacketBuffer& operator=(PacketBuffer&& other) noexcept
+  {
+    PacketBuffer tmp(std::move(other));  ///< The old slot is released, not left in other
+    std::swap(slot_, tmp.slot_);
+    return *this;
+  }
+
+  inline ~PacketBuffer()
+  {
+    reset();
+  }
+
+  inline void reset();
+
+  inline uint8_t* data()
+  {
+    unshare();
+    return slot_ == nullptr ? nullptr : slot_->data;
+  }
+
+  inline const uint8_t* data() const
+  {
+    return slot_ == nullptr ? nullptr : slot_->data;
+  }
+
+  inline size_t size() const
+  {
+    return slot_ == nullptr ? 0 : slot_->size;
+  }
+
+  inline bool empty() const
+  {
+    return size() == 0;
+  }
+
+  inline double timestamp() const
+  {
+    return slot_ == nullptr ? 0 : slot_->timestamp;
+  }
+
+  inline void setTimestamp(const double& timestamp)
+  {
+    unshare();
+    slot_->timestamp = timestamp;
+  }
+
+  inline uint8_t* begin()
+  {
+    return data();
+  }
+
+  inline uint8_t* end()
+  {
+    return data() + size();
+  }
+
+  inline const uint8_t* begin() const
+  {
+    return data();
+  }
+
+  inline const uint8_t* end() const
+  {
+    return data() + size();
+  }
+
+  inline uint8_t& operator[](const size_t& idx)
+  {
+    unshare();
+    return slot_->data[idx];
+  }
+
+  inline const uint8_t& operator[](const size_t& idx) const
+  {
+    return slot_->data[idx];
+  }
+
+  inline void resize(const size_t& size);
+
+  template <typename InputIt>
+  inline void assign(InputIt first, InputIt last);
+
+private:
+  friend class PacketPool;
+  inline explicit PacketBuffer(PacketSlot* slot) : slot_(slot)
+  {
+  }
+  inline static PacketSlot* newStandaloneSlot(const size_t& size);
+  inline void unshare();  ///< Copy the packet to a slot of its own if other handles share the slot
+
+private:
+  PacketSlot* slot_;
+};
+
+/**
+ * @brief Pool of fixed-size packet slots. The pool grows by one chunk of slots whenever it runs dry and never shrinks,
+ * so after warm-up no heap allocation is done per packet. Slots keep the pool alive until they are released.
+ */
+class PacketPool : public std::enable_shared_from_this<PacketPool>
+{
+public:
+  typedef std::shared_ptr<PacketPool> Ptr;
+  inline explicit PacketPool(const size_t& slot_size, const size_t& slots_per_chunk = 1024)
+    : slot_size_(slot_size), slots_per_chunk_(slots_per_chunk)
+  {
+  }
+  PacketPool(const PacketPool&) = delete;
+  PacketPool& operator=(const PacketPool&) = delete;
+
+  inline PacketBuffer allocate()
+  {
+    PacketSlot* slot;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (free_slots_.empty())
+      {
+        grow();
+      }
+      slot = free_slots_.back();
+      free_slots_.pop_back();
+    }
+    slot->ref_count.store(1, std::memory_order_relaxed);
+    slot->size = slot_size_;
+    slot->timestamp = 0;
+    slot->pool = shared_from_this();
+    return PacketBuffer(slot);
+  }
+
+  inline size_t slotSize() const
+  {
+    return slot_size_;
+  }
+
+  inline size_t slotNum()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slot_chunks_.size() * slots_per_chunk_;
+  }
+
+private:
+  friend class PacketBuffer;
+  inline void release(PacketSlot* slot)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_slots_.push_back(slot);
+  }
+
+  inline void grow()
+  {
+    std::unique_ptr<PacketSlot[]> slots(new PacketSlot[slots_per_chunk_]);
+    std::unique_ptr<uint8_t[]> data(new uint8_t[slots_per_chunk_ * slot_size_]);
+    free_slots_.reserve(slot_chunks_.size() * slots_per_chunk_ + slots_per_chunk_);
+    for (size_t i = 0; i < slots_per_chunk_; i++)
+    {
+      slots[i].capacity = slot_size_;
+      slots[i].data = data.get() + i * slot_size_;
+      free_slots_.push_back(&slots[i]);
+    }
+    slot_chunks_.emplace_back(std::move(slots));
+    data_chunks_.emplace_back(std::move(data));
+  }
+
+private:
+  const size_t slot_size_;
+  const size_t slots_per_chunk_;
+  std::mutex mutex_;
+  std::vector<PacketSlot*> free_slots_;
+  std::vector<std::unique_ptr<PacketSlot[]>> slot_chunks_;
+  std::vector<std::unique_ptr<uint8_t[]>> data_chunks_;
+};
+
+inline void PacketBuffer::reset()
+{
+  if (slot_ == nullptr)
+  {
+    return;
+  }
+  PacketSlot* slot = slot_;
+  slot_ = nullptr;
+  if (slot->ref_count.fetch_sub(1, std::memory_order_acq_rel) != 1)
+  {
+    return;
+  }
+  if (slot->pool != nullptr)
+  {
+    std::shared_ptr<PacketPool> pool = std::move(slot->pool);
+    pool->release(slot);
+  }
+  else
+  {
+    delete[] slot->data;
+    delete slot;
+  }
+}
+
+inline void PacketBuffer::resize(const size_t& size)
+{
+  if (slot_ != nullptr && size <= slot_->capacity && slot_->ref_count.load(std::memory_order_acquire) == 1)
+  {
+    slot_->size = size;
+    return;
+  }
+  PacketBuffer tmp;
+  tmp.slot_ = newStandaloneSlot(size);
+  if (slot_ != nullptr)
+  {
+    memcpy(tmp.data(), data(), std::min(size, this->size()));
+    tmp.slot_->timestamp = slot_->timestamp;
+  }
+  std::swap(slot_, tmp.slot_);
+}
+
+template <typename InputIt>
+inline void PacketBuffer::assign(InputIt first, InputIt last)
+{
+  size_t size = std::distance(first, last);
+  if (slot_ == nullptr || size > slot_->capacity || slot_->ref_count.load(std::memory_order_acquire) != 1)
+  {
+    PacketBuffer tmp(size);
+    std::swap(slot_, tmp.slot_);
+  }
+  slot_->size = size;
+  std::copy(first, last, slot_->data);
+}
+
+inline void PacketBuffer::unshare()
+{
+  if (slot_ == nullptr || slot_->ref_count.load(std::memory_order_acquire) == 1)
+  {
+    return;
+  }
+  PacketBuffer tmp;
+  tmp.slot_ = newStandaloneSlot(slot_->size);
+  memcpy(tmp.slot_->data, slot_->data, slot_->size);
+  tmp.slot_->timestamp = slot_->timestamp;
+  std::swap(slot_, tmp.slot_);
+}
+
+inline PacketSlot* PacketBuffer::newStandaloneSlot(const size_t& size)
+{
+  PacketSlot* slot = new PacketSlot;
+  slot->ref_count.store(1, std::memory_order_relaxed);
+  slot->size = size;
+  slot->capacity = size;
+  slot->data = new uint8_t[size]();
+  slot->timestamp = 0;
+  return slot;
+}
+
+}  // namespace lidar
+}  // namespace robosense
@@ -0,0 +1,177 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+#include <rs_driver/common/common_header.h>
+namespace robosense
+{
+namespace lidar
+{
+constexpr size_t RS_CACHE_LINE_SIZE = 64;
+
+/**
+ * @brief Bounded lock-free queue for exactly one producer thread and one consumer thread. The capacity is rounded up
+ * to a power of two. head_ is only written by the consumer and tail_ only by the producer. Each thread also caches a
+ * copy of the other side's index. head_, tail_ and the two copies are padded apart by a cache line each, so that no
+ * two of them share a line.
+ */
+template <typename T>
+class SPSCQueue
+{
+public:
+  inline explicit SPSCQueue(const size_t& capacity) : head_(0), tail_(0), cached_head_(0), cached_tail_(0)
+  {
+    size_t real_capacity = 2;
+    while (real_capacity < capacity)
+    {
+      real_capacity <<= 1;
+    }
+    buffer_.resize(real_capacity);
+    mask_ = real_capacity - 1;
+  }
+  SPSCQueue(const SPSCQueue&) = delete;
+  SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+  /* Producer side */
+  inline bool push(const T& value)
+  {
+    T tmp(value);
+    return push(std::move(tmp));
+  }
+
+  inline bool push(T&& value)
+  {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ > mask_)
+    {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ > mask_)
+      {
+        return false;
+      }
+    }
+    buffer_[tail & mask_] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  inline size_t push(const std::vector<T>& values)
+  {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail + values.size() - cached_head_ > mask_ + 1)
+    {
+      cached_head_ = head_.load(std::memory_order_acquire);
+    }
+    const size_t num = std::min(values.size(), mask_ + 1 - (tail - cached_head_));
+    for (size_t i = 0; i < num; i++)
+    {
+      buffer_[(tail + i) & mask_] = values[i];
+    }
+    tail_.store(tail + num, std::memory_order_release);
+    return num;
+  }
+
+  /* Consumer side */
+  inline bool pop(T& value)
+  {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_)
+    {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_)
+      {
+        return false;
+      }
+    }
+    value = std::move(buffer_[head & mask_]);
+    buffer_[head & mask_] = T();  ///< Do not keep what a swapping move left behind, e.g. a packet of the pool
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  inline size_t popBatch(std::vector<T>& values, const size_t& max_num)
+  {
+    values.clear();
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (cached_tail_ - head < max_num)
+    {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    }
+    const size_t num = std::min(cached_tail_ - head, max_num);
+    for (size_t i = 0; i < num; i++)
+    {
+      values.emplace_back(std::move(buffer_[(head + i) & mask_]));
+      buffer_[(head + i) & mask_] = T();
+    }
+    head_.store(head + num, std::memory_order_release);
+    return num;
+  }
+
+  inline void clear()
+  {
+    T value;
+    while (pop(value))
+    {
+    }
+  }
+
+  /* Either side */
+  inline size_t size() const
+  {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+
+  inline bool empty() const
+  {
+    return size() == 0;
+  }
+
+  inline size_t capacity() const
+  {
+    return mask_ + 1;
+  }
+
+private:
+  char pad_0_[RS_CACHE_LINE_SIZE];
+  std::atomic<size_t> head_;
+  char pad_1_[RS_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> tail_;
+  char pad_2_[RS_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+  size_t cached_head_;  ///< Producer's copy of head_
+  char pad_3_[RS_CACHE_LINE_SIZE - sizeof(size_t)];
+  size_t cached_tail_;  ///< Consumer's copy of tail_
+  char pad_4_[RS_CACHE_LINE_SIZE - sizeof(size_t)];
+  size_t mask_;
+  std::vector<T> buffer_;
+};
+}  // namespace lidar
+}  // namespace robosense
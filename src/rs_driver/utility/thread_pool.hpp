@@ -45,13 +45,86 @@ struct Thread
   std::shared_ptr<std::thread> thread_;
   std::atomic<bool> start_;
 };
+
+/**
+ * @brief Bind a thread to one CPU core. Only supported on Linux
+ * @return true if the affinity was set
+ */
+inline bool setThreadAffinity(std::thread& thread, const int& cpu)
+{
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  return (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpu_set) == 0);
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Switch a thread to the SCHED_FIFO policy with the given priority. Only supported on Linux, and usually
+ * requires CAP_SYS_NICE
+ * @return true if the priority was set
+ */
+inline bool setThreadRealtimePriority(std::thread& thread, const int& priority)
+{
+#ifdef __linux__
+  sched_param param;
+  param.sched_priority = priority;
+  return (pthread_setschedparam(thread.native_handle(), SCHED_FIFO, &param) == 0);
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Calls of one ThreadPool::parallelFor(), claimed one by one by whichever thread gets to them first
+ */
+class ParallelJob
+{
+public:
+  inline ParallelJob(const size_t& num, const std::function<void(size_t)>& func)
+    : next_(0), done_(0), num_(num), func_(&func)
+  {
+  }
+
+  inline void run()  ///< Make calls until none is left
+  {
+    for (size_t idx = next_.fetch_add(1); idx < num_; idx = next_.fetch_add(1))
+    {
+      (*func_)(idx);
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (++done_ == num_)
+      {
+        cv_.notify_all();
+      }
+    }
+  }
+
+  inline void wait()  ///< Wait until all calls are done
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return done_ == num_; });
+  }
+
+private:
+  std::atomic<size_t> next_;
+  size_t done_;
+  size_t num_;
+  const std::function<void(size_t)>* func_;  ///< Only used for claimed calls, i.e. before parallelFor() returns
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
 class ThreadPool
 {
 public:
   typedef std::shared_ptr<ThreadPool> Ptr;
-  inline ThreadPool() : stop_flag_(false), idl_thr_num_(MAX_THREAD_NUM)
+  inline explicit ThreadPool(const size_t& thread_num = MAX_THREAD_NUM)
+    : stop_flag_(false), idl_thr_num_(static_cast<int>(thread_num))
   {
-    for (int i = 0; i < idl_thr_num_; ++i)
+    for (size_t i = 0; i < thread_num; ++i)
     {
       pool_.emplace_back([this] {
         while (!this->stop_flag_)
@@ -99,6 +172,21 @@ public:
     cv_task_.notify_one();
   }
 
+  /**
+   * @brief Call func(0) ... func(num - 1) on the pool threads and the calling thread, and return when all calls are
+   * done. The calling thread makes calls too, so this neither blocks nor deadlocks if the pool threads are busy
+   */
+  inline void parallelFor(const size_t& num, const std::function<void(size_t)>& func)
+  {
+    std::shared_ptr<ParallelJob> job = std::make_shared<ParallelJob>(num, func);
+    for (size_t i = 1; i < std::min(num, pool_.size() + 1); i++)
+    {
+      commit([job] { job->run(); });
+    }
+    job->run();
+    job->wait();
+  }
+
 private:
   using Task = std::function<void()>;
   std::vector<std::thread> pool_;
@@ -0,0 +1,313 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#include <iomanip>
+#include "rs_driver/api/lidar_driver.h"
+using namespace robosense::lidar;
+
+struct PointXYZIRT
+{
+  float x;
+  float y;
+  float z;
+  uint8_t intensity;
+  uint16_t ring;
+  double timestamp;
+};
+
+constexpr uint64_t MECH_MSOP_ID = 0xA050A55A0A05AA55;  ///< RS16, RS32, RSBP
+constexpr uint32_t MECH_MSOP_ID_NEW = 0x5A05AA55;      ///< RS80, RS128, RSHELIOS
+constexpr uint32_t M1_MSOP_ID = 0xA55AAA55;
+
+bool parseArgument(int argc, const char* const* argv, const char* str, std::string& val)
+{
+  int index = -1;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], str) == 0)
+    {
+      index = i + 1;
+    }
+  }
+  if (index > 0 && index < argc)
+  {
+    val = argv[index];
+    return true;
+  }
+  return false;
+}
+
+bool hasArgument(int argc, const char* const* argv, const char* str)  ///< For switches without a value
+{
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], str) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void printHelpMenu()
+{
+  RS_MSG << "Decode synthetic msop packets and report the decoding throughput" << RS_REND;
+  RS_MSG << "Arguments are: " << RS_REND;
+  RS_MSG << "        -type             = LiDAR type( RS16, RS32, RSBP, RS128, RS80, RSM1, RSHELIOS ), all types are "
+            "measured by default"
+         << RS_REND;
+  RS_MSG << "        -frames           = Number of frames decoded for each LiDAR type, the default value is 200"
+         << RS_REND;
+  RS_MSG << "        -scalar           = Only measure the scalar kernel. By default both the scalar and the AVX2 "
+            "kernel are measured, if the CPU supports AVX2"
+         << RS_REND;
+}
+
+struct BenchmarkResult  ///< Decoding throughput, unit: Mpoints/s
+{
+  double decoder = 0;
+  double soa = 0;
+  double frame = 0;
+};
+
+/**
+ * @brief Fill one packet of a mechanical LiDAR. The blocks share the header layout of the real packets; the distance
+ * of each channel is varied so that the points spread over the valid range
+ */
+template <typename T_Msop>
+void fillMechPacket(PacketMsg& msg, const uint64_t& msop_id, const uint16_t& block_id, int& azimuth,
+                    const int& azi_step, const size_t& pkt_idx)
+{
+  msg.packet.resize(sizeof(T_Msop));
+  memset(msg.packet.data(), 0, msg.packet.size());
+  T_Msop* pkt = reinterpret_cast<T_Msop*>(msg.packet.data());
+  pkt->header.id = static_cast<decltype(pkt->header.id)>(msop_id);
+  const size_t block_num = sizeof(pkt->blocks) / sizeof(pkt->blocks[0]);
+  const size_t channel_num = sizeof(pkt->blocks[0].channels) / sizeof(pkt->blocks[0].channels[0]);
+  for (size_t blk = 0; blk < block_num; blk++)
+  {
+    pkt->blocks[blk].id = static_cast<decltype(pkt->blocks[blk].id)>(block_id);
+    pkt->blocks[blk].azimuth = RS_SWAP_SHORT(static_cast<uint16_t>(azimuth));
+    for (size_t ch = 0; ch < channel_num; ch++)
+    {
+      uint16_t distance = 400 + (pkt_idx * 131 + blk * 37 + ch * 53) % 16000;
+      pkt->blocks[blk].channels[ch].distance = RS_SWAP_SHORT(distance);
+      pkt->blocks[blk].channels[ch].intensity = static_cast<uint8_t>(ch + blk);
+    }
+    azimuth = (azimuth + azi_step) % RS_ONE_ROUND;
+  }
+}
+
+template <typename T_Msop>
+void fillMechScan(ScanMsg& scan, const uint64_t& msop_id, const uint16_t& block_id, const size_t& pkt_num)
+{
+  const size_t block_num = sizeof(T_Msop::blocks) / sizeof(T_Msop::blocks[0]);
+  const int azi_step = RS_ONE_ROUND / static_cast<int>(pkt_num * block_num);
+  int azimuth = 0;
+  scan.packets.resize(pkt_num);
+  for (size_t i = 0; i < pkt_num; i++)
+  {
+    fillMechPacket<T_Msop>(scan.packets[i], msop_id, block_id, azimuth, azi_step, i);
+  }
+}
+
+void fillM1Scan(ScanMsg& scan)
+{
+  scan.packets.resize(SINGLE_PKT_NUM);
+  for (size_t i = 0; i < SINGLE_PKT_NUM; i++)
+  {
+    PacketMsg& msg = scan.packets[i];
+    msg.packet.resize(sizeof(RSM1MsopPkt));
+    memset(msg.packet.data(), 0, msg.packet.size());
+    RSM1MsopPkt* pkt = reinterpret_cast<RSM1MsopPkt*>(msg.packet.data());
+    pkt->header.id = M1_MSOP_ID;
+    pkt->header.pkt_cnt = RS_SWAP_SHORT(static_cast<uint16_t>(i + 1));
+    for (size_t blk = 0; blk < 25; blk++)
+    {
+      for (size_t ch = 0; ch < 5; ch++)
+      {
+        RSM1Channel& channel = pkt->blocks[blk].channel[ch];
+        uint16_t distance = 400 + (i * 131 + blk * 37 + ch * 53) % 16000;
+        int pitch = static_cast<int>((i * 7 + ch * 500) % 2500) - 1250;
+        int yaw = static_cast<int>((i * 19 + blk * 40) % 12000) - 6000;
+        channel.distance = RS_SWAP_SHORT(distance);
+        channel.pitch = RS_SWAP_SHORT(static_cast<uint16_t>(pitch + ANGLE_OFFSET));
+        channel.yaw = RS_SWAP_SHORT(static_cast<uint16_t>(yaw + ANGLE_OFFSET));
+        channel.intensity = static_cast<uint8_t>(ch + blk);
+      }
+    }
+  }
+}
+
+bool fillScan(const LidarType& type, ScanMsg& scan)
+{
+  switch (type)
+  {
+    case LidarType::RS16:
+      fillMechScan<RS16MsopPkt>(scan, MECH_MSOP_ID, 0xEEFF, 75);
+      return true;
+    case LidarType::RS32:
+      fillMechScan<RS32MsopPkt>(scan, MECH_MSOP_ID, 0xEEFF, 150);
+      return true;
+    case LidarType::RSBP:
+      fillMechScan<RSBPMsopPkt>(scan, MECH_MSOP_ID, 0xEEFF, 150);
+      return true;
+    case LidarType::RS80:
+      fillMechScan<RS80MsopPkt>(scan, MECH_MSOP_ID_NEW, 0xFE, 450);
+      return true;
+    case LidarType::RS128:
+      fillMechScan<RS128MsopPkt>(scan, MECH_MSOP_ID_NEW, 0xFE, 600);
+      return true;
+    case LidarType::RSHELIOS:
+      fillMechScan<RSHELIOSMsopPkt>(scan, MECH_MSOP_ID_NEW, 0xEEFF, 150);
+      return true;
+    case LidarType::RSM1:
+      fillM1Scan(scan);
+      return true;
+    default:
+      return false;
+  }
+}
+
+BenchmarkResult runBenchmark(const LidarType& type, const size_t& frame_num, const bool& use_simd)
+{
+  RSDriverParam param;
+  param.lidar_type = type;
+  param.wait_for_difop = false;
+  param.decoder_param.use_simd = use_simd;
+  LidarDriver<PointXYZIRT> driver;
+  driver.regExceptionCallback([](const Error& code) { RS_WARNING << code.toString() << RS_REND; });
+  driver.initDecoderOnly(param);
+
+  ScanMsg scan;
+  BenchmarkResult result;
+  if (!fillScan(type, scan))
+  {
+    return result;
+  }
+
+  /* Decoder only: all packets are decoded into the same buffer */
+  std::shared_ptr<DecoderBase<PointXYZIRT>> decoder = DecoderFactory<PointXYZIRT>::createDecoder(param);
+  std::vector<PointXYZIRT> points;
+  size_t decoder_point_num = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < frame_num; i++)
+  {
+    for (const auto& pkt : scan.packets)
+    {
+      int height = 1;
+      points.clear();
+      decoder->processMsopPkt(pkt.packet.data(), points, height);
+      decoder_point_num += points.size();
+    }
+  }
+  double decoder_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  /* Decoder only, columnar output */
+  PointCloudSoA columns;
+  size_t soa_point_num = 0;
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < frame_num; i++)
+  {
+    for (const auto& pkt : scan.packets)
+    {
+      int height = 1;
+      columns.clear();
+      decoder->processMsopPkt(pkt.packet.data(), columns, height);
+      soa_point_num += columns.size();
+    }
+  }
+  double soa_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  /* Whole frame through decodeMsopScan() */
+  PointCloudMsg<PointXYZIRT> point_cloud_msg;
+  driver.decodeMsopScan(scan, point_cloud_msg);  ///< Warm up
+  size_t frame_point_num = 0;
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < frame_num; i++)
+  {
+    driver.decodeMsopScan(scan, point_cloud_msg);
+    frame_point_num += point_cloud_msg.point_cloud_ptr->size();
+  }
+  double frame_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  result.decoder = decoder_point_num / decoder_sec / 1e6;
+  result.soa = soa_point_num / soa_sec / 1e6;
+  result.frame = frame_point_num / frame_sec / 1e6;
+  RS_MSG << std::left << std::setw(10) << RSDriverParam::lidarTypeToStr(type) << std::setw(8)
+         << (use_simd ? "avx2" : "scalar") << std::right << std::setw(5) << scan.packets.size() << " pkts/frame"
+         << std::fixed << std::setprecision(1) << "    decoder " << std::setw(7) << result.decoder
+         << " Mpoints/s    soa " << std::setw(7) << result.soa << " Mpoints/s    frame " << std::setw(7)
+         << result.frame << " Mpoints/s" << RS_REND;
+  return result;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc >= 2 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0))
+  {
+    printHelpMenu();
+    return 0;
+  }
+  size_t frame_num = 200;
+  std::string result_str;
+  if (parseArgument(argc, argv, "-frames", result_str))
+  {
+    frame_num = std::stoul(result_str);
+  }
+  std::vector<LidarType> types = { LidarType::RS16,  LidarType::RS32,     LidarType::RSBP, LidarType::RS80,
+                                   LidarType::RS128, LidarType::RSHELIOS, LidarType::RSM1 };
+  if (parseArgument(argc, argv, "-type", result_str))
+  {
+    types = { RSDriverParam::strToLidarType(result_str) };
+  }
+  bool simd = !hasArgument(argc, argv, "-scalar");
+#ifdef RS_ENABLE_AVX2_KERNEL
+  simd = simd && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+  simd = false;
+#endif
+  for (auto type : types)
+  {
+    BenchmarkResult scalar = runBenchmark(type, frame_num, false);
+    if (!simd)
+    {
+      continue;
+    }
+    BenchmarkResult avx2 = runBenchmark(type, frame_num, true);
+    RS_MSG << std::left << std::setw(10) << RSDriverParam::lidarTypeToStr(type) << std::setw(8) << "speedup"
+           << std::right << std::fixed << std::setprecision(2) << "                   decoder " << std::setw(6)
+           << avx2.decoder / scalar.decoder << " x            soa " << std::setw(6) << avx2.soa / scalar.soa
+           << " x            frame " << std::setw(6) << avx2.frame / scalar.frame << " x" << RS_REND;
+  }
+  return 0;
+}
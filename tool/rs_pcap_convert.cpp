@@ -0,0 +1,477 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include "rs_driver/api/lidar_driver.h"
+using namespace robosense::lidar;
+
+struct PointXYZIRT
+{
+  float x;
+  float y;
+  float z;
+  uint8_t intensity;
+  uint16_t ring;
+  double timestamp;
+};
+
+#pragma pack(push, 1)
+struct PcdPoint  ///< One point of a binary PCD file, the fields are packed
+{
+  float x;
+  float y;
+  float z;
+  uint8_t intensity;
+  uint16_t ring;
+  double timestamp;
+};
+#pragma pack(pop)
+
+enum OutputFormat
+{
+  OUTPUT_PCD = 0,  ///< Binary PCD, organized by rings
+  OUTPUT_BIN       ///< x, y, z and intensity as float32, without invalid points (as the KITTI velodyne files)
+};
+
+struct ConvertParam
+{
+  RSDriverParam driver_param;
+  std::string out_dir = ".";
+  OutputFormat format = OUTPUT_PCD;
+  size_t thread_num = 1;
+};
+
+/**
+ * @brief The packets of one frame, prepared in packet order by the reading thread, and decoded by a worker
+ */
+struct FrameJob
+{
+  uint32_t frame;
+  std::vector<PacketMsg> packets;
+  std::vector<PacketContext> pkt_ctx;
+  std::shared_ptr<PacketMsg> difop;  ///< Last difop packet before the frame, may be empty
+};
+
+/**
+ * @brief Frames waiting to be decoded. The reading thread blocks when it is full, so that the memory used does not
+ * grow with the length of the pcap file
+ */
+class FrameQueue
+{
+public:
+  explicit FrameQueue(const size_t& max_size) : max_size_(max_size), closed_(false)
+  {
+  }
+
+  void push(FrameJob&& job)
+  {
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_push_.wait(lock, [this] { return queue_.size() < max_size_; });
+    queue_.emplace_back(std::move(job));
+    cv_pop_.notify_one();
+  }
+
+  bool pop(FrameJob& job)  ///< Returns false when the queue is closed and empty
+  {
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_pop_.wait(lock, [this] { return !queue_.empty() || closed_; });
+    if (queue_.empty())
+    {
+      return false;
+    }
+    job = std::move(queue_.front());
+    queue_.pop_front();
+    cv_push_.notify_one();
+    return true;
+  }
+
+  void close()
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    closed_ = true;
+    cv_pop_.notify_all();
+  }
+
+private:
+  std::deque<FrameJob> queue_;
+  size_t max_size_;
+  bool closed_;
+  std::mutex mtx_;
+  std::condition_variable cv_push_;
+  std::condition_variable cv_pop_;
+};
+
+struct ConvertStats
+{
+  std::atomic<uint64_t> frames{ 0 };
+  std::atomic<uint64_t> points{ 0 };
+  std::atomic<uint64_t> out_bytes{ 0 };
+  std::atomic<uint64_t> failed{ 0 };
+};
+
+bool parseArgument(int argc, const char* const* argv, const char* str, std::string& val)
+{
+  int index = -1;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], str) == 0)
+    {
+      index = i + 1;
+    }
+  }
+  if (index > 0 && index < argc)
+  {
+    val = argv[index];
+    return true;
+  }
+  return false;
+}
+
+bool parseParam(int argc, char* argv[], ConvertParam& param)
+{
+  RSDriverParam& driver_param = param.driver_param;
+  driver_param.wait_for_difop = false;
+  driver_param.saved_by_rows = true;
+  driver_param.decoder_param.use_lidar_clock = true;  ///< The time of the recording, not of the conversion
+  param.thread_num = std::max<size_t>(1, std::thread::hardware_concurrency());
+  std::string result_str;
+  if (parseArgument(argc, argv, "-type", result_str))
+  {
+    driver_param.lidar_type = RSDriverParam::strToLidarType(result_str);
+  }
+  if (parseArgument(argc, argv, "-msop", result_str))
+  {
+    driver_param.input_param.msop_port = std::stoi(result_str);
+  }
+  if (parseArgument(argc, argv, "-difop", result_str))
+  {
+    driver_param.input_param.difop_port = std::stoi(result_str);
+  }
+  if (parseArgument(argc, argv, "-angle", result_str))
+  {
+    driver_param.angle_path = result_str;
+  }
+  if (parseArgument(argc, argv, "-threads", result_str))
+  {
+    param.thread_num = std::max<size_t>(1, std::stoul(result_str));
+  }
+  if (parseArgument(argc, argv, "-format", result_str))
+  {
+    if (result_str == "bin")
+    {
+      param.format = OUTPUT_BIN;
+    }
+    else if (result_str != "pcd")
+    {
+      RS_ERROR << "Unknown output format " << result_str << RS_REND;
+      return false;
+    }
+  }
+  parseArgument(argc, argv, "-out", param.out_dir);
+  driver_param.input_param.read_pcap = parseArgument(argc, argv, "-pcap", driver_param.input_param.pcap_path);
+  if (!driver_param.input_param.read_pcap)
+  {
+    RS_ERROR << "Please set the pcap file with -pcap" << RS_REND;
+    return false;
+  }
+  return true;
+}
+
+void printHelpMenu()
+{
+  RS_MSG << "Convert a pcap file to one point cloud file per frame, decoding the frames on all cores" << RS_REND;
+  RS_MSG << "Arguments are: " << RS_REND;
+  RS_MSG << "        -pcap             = The path of the pcap or pcapng file. Files compressed with gzip, zstd or lz4 "
+            "are read if the tool is built with ENABLE_PCAP_COMPRESSION"
+         << RS_REND;
+  RS_MSG << "        -out              = The directory the frames are written to, the default value is the current "
+            "directory"
+         << RS_REND;
+  RS_MSG << "        -format           = Output format( pcd, bin ), pcd is binary PCD, bin is x, y, z, intensity as "
+            "float32. The default value is pcd"
+         << RS_REND;
+  RS_MSG << "        -threads          = Number of decoding threads, the default value is the number of cores"
+         << RS_REND;
+  RS_MSG << "        -msop             = LiDAR msop port number,the default value is 6699" << RS_REND;
+  RS_MSG << "        -difop            = LiDAR difop port number,the default value is 7788" << RS_REND;
+  RS_MSG << "        -type             = LiDAR type( RS16, RS32, RSBP, RS128, RS80, RSM1, RSHELIOS ), the default "
+            "value is RS16"
+         << RS_REND;
+  RS_MSG << "        -angle            = The path of the angle calibration file, only used if the pcap file has no "
+            "difop packets"
+         << RS_REND;
+}
+
+std::string framePath(const ConvertParam& param, const uint32_t& frame)
+{
+  std::stringstream path;
+  path << param.out_dir << "/" << std::setw(6) << std::setfill('0') << frame
+       << (param.format == OUTPUT_PCD ? ".pcd" : ".bin");
+  return path.str();
+}
+
+/**
+ * @brief Write a row major frame as binary PCD, keeping the invalid points so that the cloud stays organized
+ */
+bool writePcd(const std::string& path, const std::vector<PointXYZIRT>& cloud, const size_t& height,
+              const size_t& width, uint64_t& bytes)
+{
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file << "# .PCD v0.7 - Point Cloud Data file format\n"
+       << "VERSION 0.7\n"
+       << "FIELDS x y z intensity ring timestamp\n"
+       << "SIZE 4 4 4 1 2 8\n"
+       << "TYPE F F F U U F\n"
+       << "COUNT 1 1 1 1 1 1\n"
+       << "WIDTH " << width << "\n"
+       << "HEIGHT " << height << "\n"
+       << "VIEWPOINT 0 0 0 1 0 0 0\n"
+       << "POINTS " << cloud.size() << "\n"
+       << "DATA binary\n";
+  std::vector<PcdPoint> points(cloud.size());
+  for (size_t i = 0; i < cloud.size(); i++)
+  {
+    points[i] = { cloud[i].x, cloud[i].y, cloud[i].z, cloud[i].intensity, cloud[i].ring, cloud[i].timestamp };
+  }
+  file.write(reinterpret_cast<const char*>(points.data()), points.size() * sizeof(PcdPoint));
+  bytes = static_cast<uint64_t>(file.tellp());
+  return static_cast<bool>(file.flush());
+}
+
+/**
+ * @brief Write the valid points of a frame as float32 x, y, z, intensity
+ */
+bool writeBin(const std::string& path, const std::vector<PointXYZIRT>& cloud, uint64_t& bytes)
+{
+  std::vector<float> values;
+  values.reserve(cloud.size() * 4);
+  for (const auto& point : cloud)
+  {
+    if (!std::isnan(point.x))
+    {
+      values.insert(values.end(), { point.x, point.y, point.z, static_cast<float>(point.intensity) });
+    }
+  }
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+  bytes = values.size() * sizeof(float);
+  return static_cast<bool>(file.flush());
+}
+
+/**
+ * @brief Decode frames with a decoder of its own, so that the difop packets can be applied between two frames
+ * without stopping the other workers
+ */
+void runWorker(const ConvertParam& param, FrameQueue& queue, ConvertStats& stats)
+{
+  std::shared_ptr<DecoderBase<PointXYZIRT>> decoder = DecoderFactory<PointXYZIRT>::createDecoder(param.driver_param);
+  std::shared_ptr<PacketMsg> applied_difop;
+  std::vector<PointXYZIRT> cloud;
+  FrameJob job;
+  while (queue.pop(job))
+  {
+    if (job.difop != nullptr && job.difop != applied_difop)
+    {
+      decoder->processDifopPkt(job.difop->packet.data());
+      applied_difop = job.difop;
+    }
+    size_t point_num = 0;
+    size_t height = 1;
+    for (const auto& ctx : job.pkt_ctx)
+    {
+      if (ctx.point_num != 0)
+      {
+        height = static_cast<size_t>(ctx.height);
+      }
+      point_num += ctx.point_num;
+    }
+    size_t width = (point_num + height - 1) / height;
+    cloud.clear();
+    cloud.resize(height * width);
+    CloudSlice<std::vector<PointXYZIRT>> slice(cloud, 0, height, width);
+    for (size_t i = 0; i < job.packets.size(); i++)
+    {
+      if (job.pkt_ctx[i].point_num != 0)
+      {
+        decoder->decodePacket(job.packets[i].packet.data(), job.pkt_ctx[i], slice);
+      }
+    }
+    uint64_t bytes = 0;
+    std::string path = framePath(param, job.frame);
+    bool ret = (param.format == OUTPUT_PCD) ? writePcd(path, cloud, height, width, bytes) :
+                                              writeBin(path, cloud, bytes);
+    if (!ret)
+    {
+      RS_ERROR << "Failed to write " << path << RS_REND;
+      stats.failed++;
+      continue;
+    }
+    stats.frames++;
+    stats.points += point_num;
+    stats.out_bytes += bytes;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2 || strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)
+  {
+    printHelpMenu();
+    return 0;
+  }
+  ConvertParam param;
+  if (!parseParam(argc, argv, param))
+  {
+    return -1;
+  }
+  const RSDriverParam& driver_param = param.driver_param;
+  const RSInputParam& input_param = driver_param.input_param;
+  PcapReader reader;
+  if (!reader.open(input_param.pcap_path))
+  {
+    RS_ERROR << "Failed to open " << input_param.pcap_path << RS_REND;
+    return -1;
+  }
+  std::ofstream ts_file(param.out_dir + "/timestamps.txt", std::ios::trunc);
+  if (!ts_file)
+  {
+    RS_ERROR << "Failed to write to " << param.out_dir << RS_REND;
+    return -1;
+  }
+  ts_file << std::fixed << std::setprecision(6);
+  const uint32_t msop_pkt_length = (driver_param.lidar_type == LidarType::RSM1) ? MEMS_MSOP_LEN : MECH_PKT_LEN;
+  const uint32_t difop_pkt_length = (driver_param.lidar_type == LidarType::RSM1) ? MEMS_DIFOP_LEN : MECH_PKT_LEN;
+  RS_INFO << "Converting " << input_param.pcap_path << " with " << param.thread_num << " threads ..." << RS_REND;
+
+  ConvertStats stats;
+  FrameQueue queue(param.thread_num * 2);
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < param.thread_num; i++)
+  {
+    workers.emplace_back(runWorker, std::cref(param), std::ref(queue), std::ref(stats));
+  }
+
+  /* The frames are split in packet order on this thread, like the driver does, and decoded by the workers */
+  std::shared_ptr<DecoderBase<PointXYZIRT>> decoder = DecoderFactory<PointXYZIRT>::createDecoder(driver_param);
+  UdpParser parser;
+  PcapPacket pcap_pkt;
+  UdpDatagram udp;
+  FrameJob job;
+  std::shared_ptr<PacketMsg> difop;
+  bool first_frame = true;  ///< The first frame is usually cut by the start of the capture, and skipped as the driver
+  uint32_t frame = 0;
+  uint64_t pkt_num = 0;
+  double first_ts = 0;
+  double last_ts = 0;
+  auto start = std::chrono::steady_clock::now();
+  auto last_report = start;
+  while (reader.next(pcap_pkt))
+  {
+    if (!parser.parse(pcap_pkt, udp))
+    {
+      continue;
+    }
+    if (udp.dst_port == input_param.difop_port && udp.payload_len >= difop_pkt_length)
+    {
+      difop = std::make_shared<PacketMsg>(difop_pkt_length);
+      memcpy(difop->packet.data(), udp.payload, difop_pkt_length);
+      decoder->processDifopPkt(difop->packet.data());
+      continue;
+    }
+    if (udp.dst_port != input_param.msop_port || udp.payload_len < msop_pkt_length)
+    {
+      continue;
+    }
+    PacketMsg pkt(msop_pkt_length);
+    memcpy(pkt.packet.data(), udp.payload, msop_pkt_length);
+    PacketContext ctx;
+    RSDecoderResult result = decoder->prepareMsopPkt(pkt.packet.data(), ctx);
+    if (result != DECODE_OK && result != FRAME_SPLIT)
+    {
+      continue;
+    }
+    pkt_num++;
+    job.packets.emplace_back(std::move(pkt));
+    job.pkt_ctx.emplace_back(ctx);
+    if (result != FRAME_SPLIT)
+    {
+      continue;
+    }
+    if (!first_frame)
+    {
+      double ts = decoder->getLidarTime(job.packets.back().packet.data());
+      first_ts = (frame == 0) ? ts : first_ts;
+      last_ts = ts;
+      ts_file << frame << " " << ts << "\n";
+      job.frame = frame++;
+      job.difop = difop;
+      queue.push(std::move(job));
+    }
+    first_frame = false;
+    job = FrameJob();
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_report > std::chrono::seconds(2))
+    {
+      RS_INFO << std::fixed << std::setprecision(1) << 100.0 * reader.progress() << "%, "
+              << stats.frames.load() << " frames written" << RS_REND;
+      last_report = now;
+    }
+  }
+  if (!job.packets.empty())  ///< Not split yet, the last frame is cut by the end of the capture
+  {
+    RS_WARNING << "The last frame is incomplete, its " << job.packets.size() << " packets are skipped" << RS_REND;
+  }
+  if (reader.failed())
+  {
+    RS_ERROR << input_param.pcap_path << " is corrupt or truncated, the frames after the damage are missing"
+             << RS_REND;
+  }
+  queue.close();
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double lidar_sec = last_ts - first_ts;
+
+  RS_MSG << std::fixed << std::setprecision(1) << "Frames:       " << stats.frames.load() << " written, "
+         << stats.failed.load() << " failed" << RS_REND;
+  RS_MSG << "Packets:      " << pkt_num << "    Points: " << stats.points.load() << RS_REND;
+  RS_MSG << "Time:         " << sec << " s for " << lidar_sec << " s of LiDAR data, " << lidar_sec / sec
+         << " x real time" << RS_REND;
+  RS_MSG << "Throughput:   " << stats.frames.load() / sec << " frames/s    " << stats.points.load() / sec / 1e6
+         << " Mpoints/s    " << reader.fileSize() / sec / 1e6 << " MB/s read    " << stats.out_bytes.load() / sec / 1e6
+         << " MB/s written" << RS_REND;
+  return (stats.failed.load() == 0 && !reader.failed()) ? 0 : -1;
+}